@@ -2736,6 +2736,7 @@ namespace madness {
                     }
                 }
 
+                WorldTaskQueue::Batch batch(world.taskq);
                 for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
                     const keyT& child = kit.key();
                     Tensor<L> ll;
@@ -2827,6 +2828,7 @@ namespace madness {
                 rss = right->unfilter(rd);
             }
 
+            WorldTaskQueue::Batch batch(world.taskq);
             for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
                 const keyT& child = kit.key();
                 Tensor<L> ll;
@@ -2897,6 +2899,7 @@ namespace madness {
                 rss = right->unfilter(rd);
             }
 
+            WorldTaskQueue::Batch batch(world.taskq);
             for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
                 const keyT& child = kit.key();
                 Tensor<L> ll;
@@ -2953,6 +2956,7 @@ namespace madness {
             if (fc.size() == 0) {
                 // Recur down
                 coeffs.replace(key, nodeT(coeffT(),true)); // Interior node
+                WorldTaskQueue::Batch batch(world.taskq);
                 for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
                     const keyT& child = kit.key();
                     woT::task(coeffs.owner(child), &implT:: template unaryXXa<Q,opT>, child, func, op);
@@ -3479,6 +3483,7 @@ namespace madness {
 
             const bool has_children=(not arg.first);
             if (has_children) {
+                WorldTaskQueue::Batch batch(world.taskq);
                 for (KeyChildIterator<NDIM> kit(key); kit; ++kit) {
                     const keyT& child=kit.key();
                     coeff_opT child_op=coeff_op.make_child(child);
@@ -5508,6 +5513,7 @@ namespace madness {
                     below_leaf = true;
                 } else {
                     this->coeffs.replace(key, nodeT(coeffT(), true));
+                    WorldTaskQueue::Batch batch(world.taskq);
                     for (KeyChildIterator<NDIM> it(key); it; ++it) {
                         const keyT& child = it.key();
                         woT::task(left->coeffs.owner(child), &implT:: template gaxpy_ext_recursive<L>,
@@ -5570,6 +5576,7 @@ namespace madness {
                 // Otherwise, make this a parent node and recur down
                 this->coeffs.replace(key, nodeT(coeffT(), true)); // Interior node
 
+                WorldTaskQueue::Batch batch(world.taskq);
                 for (KeyChildIterator<NDIM> it(key); it; ++it) {
                     const keyT& child = it.key();
                     tensorT child_coeff = tensorT(c_child(child_patch(child)));
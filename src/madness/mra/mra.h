@@ -669,8 +669,9 @@ namespace madness {
             if (VERIFY_TREE) verify_tree();
             double local = impl->norm2sq_local();
 
-            impl->world.gop.sum(local);
+            Future<bool> done = impl->world.gop.isum(&local, 1);
             impl->world.gop.fence();
+            done.get();
             return sqrt(local);
         }
 
@@ -1209,7 +1209,7 @@ namespace madness {
     template <typename T, std::size_t NDIM>
     typename FunctionImpl<T,NDIM>::tensorT FunctionImpl<T,NDIM>::filter(const tensorT& s) const {
         tensorT r(cdata.v2k,false);
-        tensorT w(cdata.v2k,false);
+        ScratchTensor<T> w(cdata.v2k);
         return fast_transform(s,cdata.hgT,r,w);
         //return transform(s,cdata.hgT);
     }
@@ -1238,7 +1238,7 @@ namespace madness {
     template <typename T, std::size_t NDIM>
     typename FunctionImpl<T,NDIM>::tensorT FunctionImpl<T,NDIM>::unfilter(const tensorT& s) const {
         tensorT r(cdata.v2k,false);
-        tensorT w(cdata.v2k,false);
+        ScratchTensor<T> w(cdata.v2k);
         return fast_transform(s,cdata.hg,r,w);
         //return transform(s, cdata.hg);
     }
@@ -2416,6 +2416,7 @@ namespace madness {
             // refine if difference norm is big
             if (newspecialpts.size() > 0 || dnorm >=truncate_tol(thresh,key.level())) {
                 coeffs.replace(key,nodeT(coeffT(),true)); // Insert empty node for parent
+                WorldTaskQueue::Batch batch(world.taskq); // Submit the children together
                 for (KeyChildIterator<NDIM> it(key); it; ++it) {
                     const keyT& child = it.key();
                     ProcessID p;
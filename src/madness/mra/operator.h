@@ -179,6 +179,12 @@ namespace madness {
             const Q* VT;
         };
 
+        /// One separated term ready to apply: its factor and a transformation per dimension
+        struct TransformationTerm {
+            Q fac;
+            Transformation trans[NDIM];
+        };
+
 //        /// return the right block of the upsampled operator (modified NS only)
 //
 //        /// unlike the operator matrices on the natural level the upsampled operator
@@ -275,6 +281,59 @@ namespace madness {
         }
 
 
+        /// accumulate all the terms applied to f into result
+
+        /// Terms of full rank in every dimension, the most common by far,
+        /// fold their factor into a copy of the first matrix and add the
+        /// last product straight into result, so that the only passes
+        /// through work1/work2 are between dimensions.  Low-rank terms go
+        /// through apply_transformation.
+        template <typename T, typename R>
+        void apply_transformations(long dimk,
+                                   const std::vector<TransformationTerm>& terms,
+                                   const Tensor<T>& f,
+                                   Tensor<R>& work1,
+                                   Tensor<R>& work2,
+                                   Tensor<R>& result) const {
+            if (terms.empty()) return;
+
+            long size = 1;
+            for (std::size_t i=0; i<NDIM; ++i) size *= dimk;
+            const long dimi = size/dimk;
+
+            const long d[2] = {dimk, dimk};
+            ScratchTensor<Q> u0(2, d);
+            Q* MADNESS_RESTRICT s = u0.ptr();
+
+            for (const TransformationTerm& term : terms) {
+                bool lowrank = false;
+                for (std::size_t d=0; d<NDIM; ++d) lowrank = lowrank || term.trans[d].VT;
+                if (lowrank) {
+                    apply_transformation(dimk, term.trans, f, work1, work2, term.fac, result);
+                    continue;
+                }
+
+                const Q* U = term.trans[0].U;
+                for (long i=0; i<dimk*dimk; ++i) s[i] = term.fac*U[i];
+
+                // Assuming here that result is contiguous
+                if (NDIM == 1) {
+                    mTxm(dimi, dimk, dimk, result.ptr(), f.ptr(), s);
+                    continue;
+                }
+
+                R* MADNESS_RESTRICT w1=work1.ptr();
+                R* MADNESS_RESTRICT w2=work2.ptr();
+                mTxmq(dimi, dimk, dimk, w1, f.ptr(), s);
+                for (std::size_t d=1; d<NDIM-1; ++d) {
+                    mTxmq(dimi, dimk, dimk, w2, w1, term.trans[d].U);
+                    std::swap(w1,w2);
+                }
+                mTxm(dimi, dimk, dimk, result.ptr(), w1, term.trans[NDIM-1].U);
+            }
+        }
+
+
         /// accumulate into result
         template <typename T, typename R>
         void apply_transformation3(const Tensor<T> trans2[NDIM],
@@ -352,21 +411,20 @@ namespace madness {
         }
 
 
-        /// Apply one of the separated terms, accumulating into the result
-        template <typename T>
-        void muopxv_fast(ApplyTerms at,
-                         const ConvolutionData1D<Q>* const ops_1d[NDIM],
-                         const Tensor<T>& f, const Tensor<T>& f0,
-                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& result,
-                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& result0,
-                         double tol,
-                         const Q mufac,
-                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& work1,
-                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& work2) const {
+        /// Select the transformations of one of the separated terms
+
+        /// The r-term is appended to \c rterms and the t-term to \c tterms,
+        /// unless their rank is zero.
+        void muopxv_terms(ApplyTerms at,
+                          const ConvolutionData1D<Q>* const ops_1d[NDIM],
+                          double tol,
+                          const Q mufac,
+                          std::vector<TransformationTerm>& rterms,
+                          std::vector<TransformationTerm>& tterms) const {
 
             //PROFILE_MEMBER_FUNC(SeparatedConvolution); // Too fine grain for routine profiling
-            Transformation trans[NDIM];
-            Tensor<T> trans2[NDIM];
+            TransformationTerm term;
+            Transformation* trans = term.trans;
 
             double Rnorm = 1.0;
             for (std::size_t d=0; d<NDIM; ++d) Rnorm *= ops_1d[d]->Rnorm;
@@ -408,14 +466,12 @@ namespace madness {
                         trans[d].U = ops_1d[d]->RU.ptr();
                         trans[d].VT = ops_1d[d]->RVT.ptr();
                     }
-                    trans2[d]=ops_1d[d]->R;
                 }
 
-                if (!rank_is_zero)
-                    apply_transformation(twok, trans, f, work1, work2, mufac, result);
-
-                //            apply_transformation2(n, twok, tol, trans2, f, work1, work2, mufac, result);
-//                apply_transformation3(trans2, f, mufac, result);
+                if (!rank_is_zero) {
+                    term.fac = mufac;
+                    rterms.push_back(term);
+                }
             }
 
             double Tnorm = 1.0;
@@ -453,16 +509,51 @@ namespace madness {
                         trans[d].U = ops_1d[d]->TU.ptr();
                         trans[d].VT = ops_1d[d]->TVT.ptr();
                     }
-                    trans2[d]=ops_1d[d]->T;
                 }
-                if (!rank_is_zero)
-                    apply_transformation(k, trans, f0, work1, work2, -mufac, result0);
-//                apply_transformation2(n, k, tol, trans2, f0, work1, work2, -mufac, result0);
-//                apply_transformation3(trans2, f0, -mufac, result0);
+                if (!rank_is_zero) {
+                    term.fac = -mufac;
+                    tterms.push_back(term);
+                }
             }
         }
 
 
+
+        /// Apply the separated terms, accumulating into the result
+
+        /// The terms with norm above \c normtol are selected first and then
+        /// applied in one batch each to \c f and \c f0, so that the input
+        /// stays in cache from one term to the next.
+        template <typename T>
+        void muopxv_fast(ApplyTerms at,
+                         const SeparatedConvolutionData<Q,NDIM>* op,
+                         const Tensor<T>& f, const Tensor<T>& f0,
+                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& result,
+                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& result0,
+                         double tol,
+                         double normtol,
+                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& work1,
+                         Tensor<TENSOR_RESULT_TYPE(T,Q)>& work2) const {
+
+            std::vector<TransformationTerm> rterms, tterms;
+            rterms.reserve(rank);
+            tterms.reserve(rank);
+            for (int mu=0; mu<rank; ++mu) {
+                // SeparatedConvolutionInternal keeps data for 1 term and all dimensions and 1 displacement
+                const SeparatedConvolutionInternal<Q,NDIM>& muop =  op->muops[mu];
+                if (muop.norm > normtol) {
+                    // ops is of ConvolutionND, returns data for 1 term and all dimensions
+                    Q fac = ops[mu].getfac();
+                    muopxv_terms(at, muop.ops, tol/std::abs(fac), fac, rterms, tterms);
+                }
+            }
+
+            const long twok = modified() ? k : 2*k;
+            apply_transformations(twok, rterms, f, work1, work2, result);
+            apply_transformations(k, tterms, f0, work1, work2, result0);
+        }
+
+
         /// Apply one of the separated terms, accumulating into the result
         template <typename T>
         void muopxv_fast2(Level n,
@@ -1042,6 +1133,9 @@ namespace madness {
 
         const BoundaryConditions<NDIM>& get_bc() const {return bc;}
 
+        /// Number of separated terms
+        int get_rank() const {return rank;}
+
         const std::vector< Key<NDIM> >& get_disp(Level n) const {
             return Displacements<NDIM>().get_disp(n, isperiodicsum);
         }
@@ -1156,26 +1250,13 @@ namespace madness {
 
             //print("sepop",source,shift,op->norm,tol);
 
-            Tensor<resultT> r(v2k), r0(vk);
-            Tensor<resultT> work1(v2k,false), work2(v2k,false);
+            const std::vector<long>& vr = modified() ? vk : v2k;
+            Tensor<resultT> r(vr);
+            ScratchTensor<resultT> r0(vk,true), work1(vr), work2(vr);
 
-            if (modified()) {
-                   r=Tensor<resultT>(vk);
-                   work1=Tensor<resultT>(vk,false);
-                   work2=Tensor<resultT>(vk,false);
-            }
-
-            const Tensor<T> f0 = copy(coeff(s0));
-            for (int mu=0; mu<rank; ++mu) {
-                // SeparatedConvolutionInternal keeps data for 1 term and all dimensions and 1 displacement
-                const SeparatedConvolutionInternal<Q,NDIM>& muop =  op->muops[mu];
-                if (muop.norm > tol) {
-                    // ops is of ConvolutionND, returns data for 1 term and all dimensions
-                    Q fac = ops[mu].getfac();
-                    muopxv_fast(at, muop.ops, *input, f0, r, r0, tol/std::abs(fac), fac,
-                                work1, work2);
-                }
-            }
+            ScratchTensor<T> f0(vk);
+            f0(___) = coeff(s0);
+            muopxv_fast(at, op, *input, f0, r, r0, tol, tol, work1, work2);
 
             r(s0).gaxpy(1.0,r0,1.0);
             double cpu1=cpu_time();
@@ -1219,7 +1300,7 @@ namespace madness {
             const SeparatedConvolutionData<Q,NDIM>* op = getop(source.level(), shift, source);
 
             // some workspace
-            Tensor<resultT> work1(v2k,false), work2(v2k,false);
+            ScratchTensor<resultT> work1(v2k), work2(v2k);
 
             // sliced input and final result
             const GenTensor<T> f0 = copy(coeff(s00));
@@ -1244,20 +1325,15 @@ namespace madness {
 //                const double weight=std::abs(coeff.config().weights(r));
 
                 // accumulate all terms of the operator for a specific term of the function
-                Tensor<resultT> result(v2k), result0(vk);
+                ScratchTensor<resultT> result(v2k,true), result0(vk,true);
 
                 ApplyTerms at;
                 at.r_term=true;
                 at.t_term=source.level()>0;
 
-                // this loop will return on result and result0 the terms [(P+Q) G (P+Q)]_1,
-                // and [P G P]_1, respectively
-                for (int mu=0; mu<rank; ++mu) {
-                    const SeparatedConvolutionInternal<Q,NDIM>& muop =  op->muops[mu];
-                    Q fac = ops[mu].getfac();
-                    muopxv_fast(at, muop.ops, chunk, chunk0, result, result0,
-                            tol/std::abs(fac), fac, work1, work2);
-                }
+                // this will return on result and result0 the terms [(P+Q) G (P+Q)]_1,
+                // and [P G P]_1, respectively, applying all terms of the operator
+                muopxv_fast(at, op, chunk, chunk0, result, result0, tol, -1.0, work1, work2);
 
                 // reinsert the transformed terms into result, leaving the other particle unchanged
                 MADNESS_ASSERT(final.config().has_structure());
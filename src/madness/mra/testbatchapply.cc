@@ -0,0 +1,109 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file testbatchapply.cc
+/// \brief Times the application of a separated operator to one block of coefficients
+
+/// All separated terms of the operator are applied to the block in one
+/// batch (SeparatedConvolution::muopxv_fast).  Prints the time per block
+/// for k=6..12, for NDIM=3 on blocks of (2k)^3 and for NDIM=6 with the
+/// modified operator on blocks of k^6.  Options: k=<max k>, ndim=<3|6>.
+
+#include <madness/mra/mra.h>
+#include <madness/mra/operator.h>
+
+using namespace madness;
+
+template <std::size_t NDIM>
+void bench(World& world, int k, bool modified) {
+    FunctionDefaults<NDIM>::set_k(k);
+    FunctionDefaults<NDIM>::set_cubic_cell(-20.0, 20.0);
+    SeparatedConvolution<double,NDIM> op = BSHOperator<NDIM>(world, 1.0, 1.e-4, 1.e-6);
+    op.modified() = modified;
+
+    const long n = modified ? k : 2*k;
+    Tensor<double> coeff(std::vector<long>(NDIM, n));
+    coeff.fillrandom();
+
+    const Key<NDIM> source(4, Vector<Translation,NDIM>(8));
+    Vector<Translation,NDIM> l(0);
+    const Key<NDIM> self(4, l);
+    l[0] = 1;
+    const Key<NDIM> neighbor(4, l);
+    const double tol = 1.e-10;
+
+    // The first application computes and caches the operator blocks
+    double norm = op.apply(source, self, coeff, tol).normf() + op.apply(source, neighbor, coeff, tol).normf();
+
+    const long nflop_step = 2*coeff.size()*n;   // one mTxmq of (n^(NDIM-1),n)T*(n,n)
+    const int nrep = std::max(1L, 100000000L/(nflop_step*long(NDIM)*op.get_rank()));
+    double wall0 = wall_time();
+    for (int rep=0; rep<nrep; ++rep) {
+        norm += op.apply(source, self, coeff, tol).normf();
+        norm += op.apply(source, neighbor, coeff, tol).normf();
+    }
+    double wall1 = wall_time();
+    if (norm == 0.0) print("zero norm");
+
+    const double t = (wall1-wall0)/(2*nrep);
+    printf("%4d %3d %4d %6ld %12.3f %8.2f\n", int(NDIM), k, op.get_rank(), n,
+           t*1e3, 1e-9*nflop_step*NDIM*op.get_rank()/t);
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    {
+        World world(SafeMPI::COMM_WORLD);
+        startup(world, argc, argv);
+
+        int kmax = 12, ndim = 0;
+        for (int i=1; i<argc; i++) {
+            const std::string arg = argv[i];
+            const std::size_t pos = arg.find("=");
+            const std::string key = arg.substr(0, pos);
+            const std::string val = arg.substr(pos+1);
+            if (key == "k") kmax = std::atoi(val.c_str());
+            if (key == "ndim") ndim = std::atoi(val.c_str());
+        }
+
+        // The flop rate assumes every term is applied at full rank
+        printf("%4s %3s %4s %6s %12s %8s\n", "NDIM", "k", "rank", "block", "ms/block", "~GF/s");
+        if (ndim == 0 || ndim == 3) {
+            for (int k=6; k<=kmax; ++k) bench<3>(world, k, false);
+        }
+        if (ndim == 0 || ndim == 6) {
+            for (int k=6; k<=kmax; ++k) bench<6>(world, k, true);
+        }
+        world.gop.fence();
+    }
+    finalize();
+    return 0;
+}
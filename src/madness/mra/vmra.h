@@ -633,9 +633,10 @@ namespace madness {
         PROFILE_BLOCK(Vnorm2);
         std::vector<double> norms(v.size());
         for (unsigned int i=0; i<v.size(); ++i) norms[i] = v[i].norm2sq_local();
-        world.gop.sum(&norms[0], norms.size());
-        for (unsigned int i=0; i<v.size(); ++i) norms[i] = sqrt(norms[i]);
+        Future<bool> done = world.gop.isum(norms.data(), norms.size());
         world.gop.fence();
+        done.get();
+        for (unsigned int i=0; i<v.size(); ++i) norms[i] = sqrt(norms[i]);
         return norms;
     }
 
@@ -644,12 +645,12 @@ namespace madness {
     double norm2(World& world,const std::vector< Function<T,NDIM> >& v) {
         PROFILE_BLOCK(Vnorm2);
         if (v.size()==0) return 0.0;
-        std::vector<double> norms(v.size());
-        for (unsigned int i=0; i<v.size(); ++i) norms[i] = v[i].norm2sq_local();
-        world.gop.sum(&norms[0], norms.size());
-        for (unsigned int i=1; i<v.size(); ++i) norms[0] += norms[i];
+        double norm = 0.0;
+        for (unsigned int i=0; i<v.size(); ++i) norm += v[i].norm2sq_local();
+        Future<bool> done = world.gop.isum(&norm, 1);
         world.gop.fence();
-        return sqrt(norms[0]);
+        done.get();
+        return sqrt(norm);
     }
 
     inline double conj(double x) {
@@ -746,8 +747,9 @@ namespace madness {
 
         Tensor< TENSOR_RESULT_TYPE(T,R) > r= FunctionImpl<T,NDIM>::inner_local(left, right, sym);
 
+        Future<bool> done = world.gop.isum(r.ptr(),f.size()*g.size());
         world.gop.fence();
-        world.gop.sum(r.ptr(),f.size()*g.size());
+        done.get();
 
         return r;
     }
@@ -816,8 +818,9 @@ namespace madness {
         }
 
         world.taskq.fence();
-        world.gop.sum(r.ptr(),n);
+        Future<bool> done = world.gop.isum(r.ptr(),n);
         world.gop.fence();
+        done.get();
         return r;
     }
 
@@ -839,8 +842,9 @@ namespace madness {
         }
 
         world.taskq.fence();
-        world.gop.sum(r.ptr(),n);
+        Future<bool> done = world.gop.isum(r.ptr(),n);
         world.gop.fence();
+        done.get();
         return r;
     }
 
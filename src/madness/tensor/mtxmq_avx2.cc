@@ -0,0 +1,85 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file tensor/mtxmq_avx2.cc
+/// \brief AVX2/FMA instantiation of the mTxmq micro-kernels
+
+// Compiled with -mavx2 -mfma and only called after checking the CPU at
+// run time (see mtxmq_simd.cc).  Includes nothing but the intrinsics.
+
+#include <immintrin.h>
+#include <madness/tensor/mtxmq_kernels.h>
+
+namespace madness {
+    namespace {
+
+        /// 16 ymm registers: 12 accumulators, the row of b and a broadcast
+        struct Avx2 {
+            typedef __m256d vec;
+            typedef __m256i mask;
+            static const int W = 4;
+            static const int MR = 4, NR = 3;     // real
+            static const int MRZ = 3, NRZ = 2;   // complex
+
+            static vec zero() { return _mm256_setzero_pd(); }
+            static vec bcast(const double* p) { return _mm256_broadcast_sd(p); }
+            static vec load(const double* p) { return _mm256_loadu_pd(p); }
+            static vec load(const double* p, mask m) { return _mm256_maskload_pd(p, m); }
+            static void store(double* p, vec v) { _mm256_storeu_pd(p, v); }
+            static void store(double* p, vec v, mask m) { _mm256_maskstore_pd(p, m, v); }
+            static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+            static vec fma(vec a, vec b, vec c) { return _mm256_fmadd_pd(a, b, c); }
+            static vec cmul(vec re, vec im) {
+                return _mm256_addsub_pd(re, _mm256_permute_pd(im, 0x5));
+            }
+            static mask make_mask(int n) {
+                return _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_set_epi64x(3, 2, 1, 0));
+            }
+        };
+
+    }
+
+    namespace detail {
+
+        void mtxmq_avx2(long dimi, long dimj, long dimk,
+                        double* c, const double* a, const double* b, long ldb, bool acc) {
+            if (acc) mtxmq_driver<Avx2,false,true>(dimi, dimj, dimk, c, a, b, ldb);
+            else mtxmq_driver<Avx2,false,false>(dimi, dimj, dimk, c, a, b, ldb);
+        }
+
+        void mtxmq_avx2_complex(long dimi, long dimj, long dimk,
+                                double* c, const double* a, const double* b, long ldb, bool acc) {
+            if (acc) mtxmq_driver<Avx2,true,true>(dimi, dimj, dimk, c, a, b, ldb);
+            else mtxmq_driver<Avx2,true,false>(dimi, dimj, dimk, c, a, b, ldb);
+        }
+
+    }
+}
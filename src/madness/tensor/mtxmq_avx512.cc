@@ -0,0 +1,83 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file tensor/mtxmq_avx512.cc
+/// \brief AVX-512 instantiation of the mTxmq micro-kernels
+
+// Compiled with -mavx512f and only called after checking the CPU at run
+// time (see mtxmq_simd.cc).  Includes nothing but the intrinsics.
+
+#include <immintrin.h>
+#include <madness/tensor/mtxmq_kernels.h>
+
+namespace madness {
+    namespace {
+
+        /// 32 zmm registers: 24 accumulators, the row of b and a broadcast
+        struct Avx512 {
+            typedef __m512d vec;
+            typedef __mmask8 mask;
+            static const int W = 8;
+            static const int MR = 8, NR = 3;     // real
+            static const int MRZ = 4, NRZ = 3;   // complex
+
+            static vec zero() { return _mm512_setzero_pd(); }
+            static vec bcast(const double* p) { return _mm512_set1_pd(*p); }
+            static vec load(const double* p) { return _mm512_loadu_pd(p); }
+            static vec load(const double* p, mask m) { return _mm512_maskz_loadu_pd(m, p); }
+            static void store(double* p, vec v) { _mm512_storeu_pd(p, v); }
+            static void store(double* p, vec v, mask m) { _mm512_mask_storeu_pd(p, m, v); }
+            static vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+            static vec fma(vec a, vec b, vec c) { return _mm512_fmadd_pd(a, b, c); }
+            static vec cmul(vec re, vec im) {
+                return _mm512_fmaddsub_pd(re, _mm512_set1_pd(1.0), _mm512_permute_pd(im, 0x55));
+            }
+            static mask make_mask(int n) { return mask((1u << n) - 1u); }
+        };
+
+    }
+
+    namespace detail {
+
+        void mtxmq_avx512(long dimi, long dimj, long dimk,
+                          double* c, const double* a, const double* b, long ldb, bool acc) {
+            if (acc) mtxmq_driver<Avx512,false,true>(dimi, dimj, dimk, c, a, b, ldb);
+            else mtxmq_driver<Avx512,false,false>(dimi, dimj, dimk, c, a, b, ldb);
+        }
+
+        void mtxmq_avx512_complex(long dimi, long dimj, long dimk,
+                                  double* c, const double* a, const double* b, long ldb, bool acc) {
+            if (acc) mtxmq_driver<Avx512,true,true>(dimi, dimj, dimk, c, a, b, ldb);
+            else mtxmq_driver<Avx512,true,false>(dimi, dimj, dimk, c, a, b, ldb);
+        }
+
+    }
+}
@@ -0,0 +1,212 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_MTXMQ_KERNELS_H__INCLUDED
+#define MADNESS_TENSOR_MTXMQ_KERNELS_H__INCLUDED
+
+/// \file tensor/mtxmq_kernels.h
+/// \brief Register-blocked mTxmq micro-kernels, generated per instruction set
+
+// Internal to the library.  Only included into the per-ISA translation
+// units (mtxmq_avx2.cc, mtxmq_avx512.cc), which are compiled with the
+// matching -m flags.  Do not include anything else here: inline functions
+// emitted in those units would be compiled for that ISA and might be
+// picked by the linker for use elsewhere.
+//
+// A translation unit provides a vector traits class V with
+//
+//   typedef ... vec;       // W doubles
+//   typedef ... mask;      // selects the first n<=W doubles of a vector
+//   static const int W, MR, NR, MRZ, NRZ;
+//   vec  zero(); vec bcast(const double*);
+//   vec  load(const double*); vec load(const double*, mask);
+//   void store(double*, vec); void store(double*, vec, mask);
+//   vec  add(vec a, vec b); vec fma(vec a, vec b, vec c);    // a*b+c
+//   vec  cmul(vec re, vec im);         // re + i*swap(im), see below
+//   mask make_mask(int n);
+//
+// and calls mtxmq_driver<V,CPLX,ACC> with CPLX for complex data and ACC to
+// add the product to c rather than overwrite c.
+// MR x NR is the register block (rows of c by vectors of c) of the real
+// kernel, MRZ x NRZ that of the complex one.  Every smaller block needed
+// for edges is instantiated from the same template.
+//
+// All complex data is viewed as interleaved doubles.  The complex kernel
+// accumulates re(a)*b and im(a)*b separately and combines them on store
+// as re(a)*b + i*im(a)*b, which is what V::cmul does.
+
+#if defined(__GNUC__)
+#define MADNESS_MTXMQ_UNROLL _Pragma("GCC unroll 16")
+#else
+#define MADNESS_MTXMQ_UNROLL
+#endif
+
+namespace madness {
+    namespace {
+
+        /// One register block of c(i,j) = sum(k) a(k,i)*b(k,j)
+
+        /// \c c, \c a and \c b point at the block; all leading dimensions
+        /// are in doubles.  If \c TAIL the last of the \c NR vectors holds
+        /// only the doubles selected by \c m.  If \c ACC the block is added
+        /// to \c c.
+        template <typename V, bool CPLX, bool ACC, int MR, int NR, bool TAIL>
+        void mtxmq_block(long dimk, double* c, long ldc,
+                         const double* a, long lda,
+                         const double* b, long ldb, typename V::mask m) {
+            typedef typename V::vec vec;
+            const int NA = CPLX ? 2 : 1;
+            vec acc[NA][MR][NR];
+
+            MADNESS_MTXMQ_UNROLL
+            for (int s=0; s<NA; ++s)
+                MADNESS_MTXMQ_UNROLL
+                for (int r=0; r<MR; ++r)
+                    MADNESS_MTXMQ_UNROLL
+                    for (int v=0; v<NR; ++v) acc[s][r][v] = V::zero();
+
+            for (long k=0; k<dimk; ++k, a+=lda, b+=ldb) {
+                vec bk[NR];
+                MADNESS_MTXMQ_UNROLL
+                for (int v=0; v<NR; ++v)
+                    bk[v] = (TAIL && v==NR-1) ? V::load(b+v*V::W, m) : V::load(b+v*V::W);
+                MADNESS_MTXMQ_UNROLL
+                for (int r=0; r<MR; ++r) {
+                    MADNESS_MTXMQ_UNROLL
+                    for (int s=0; s<NA; ++s) {
+                        const vec aki = V::bcast(a+r*NA+s);
+                        MADNESS_MTXMQ_UNROLL
+                        for (int v=0; v<NR; ++v) acc[s][r][v] = V::fma(aki, bk[v], acc[s][r][v]);
+                    }
+                }
+            }
+
+            MADNESS_MTXMQ_UNROLL
+            for (int r=0; r<MR; ++r, c+=ldc) {
+                MADNESS_MTXMQ_UNROLL
+                for (int v=0; v<NR; ++v) {
+                    vec cij = CPLX ? V::cmul(acc[0][r][v], acc[NA-1][r][v]) : acc[0][r][v];
+                    if (TAIL && v==NR-1) {
+                        if (ACC) cij = V::add(cij, V::load(c+v*V::W, m));
+                        V::store(c+v*V::W, cij, m);
+                    }
+                    else {
+                        if (ACC) cij = V::add(cij, V::load(c+v*V::W));
+                        V::store(c+v*V::W, cij);
+                    }
+                }
+            }
+        }
+
+        /// Selects the block instantiation for the \c mr rows and \c nv vectors left at an edge
+        template <typename V, bool CPLX, bool ACC, int MR, int NR>
+        struct MtxmqEdge {
+            static void run(int mr, int nv, bool tail, long dimk, double* c, long ldc,
+                            const double* a, long lda, const double* b, long ldb,
+                            typename V::mask m) {
+                if (mr < MR) {
+                    MtxmqEdge<V,CPLX,ACC,MR-1,NR>::run(mr, nv, tail, dimk, c, ldc, a, lda, b, ldb, m);
+                }
+                else if (nv < NR) {
+                    MtxmqEdge<V,CPLX,ACC,MR,NR-1>::run(mr, nv, tail, dimk, c, ldc, a, lda, b, ldb, m);
+                }
+                else if (tail) {
+                    mtxmq_block<V,CPLX,ACC,MR,NR,true>(dimk, c, ldc, a, lda, b, ldb, m);
+                }
+                else {
+                    mtxmq_block<V,CPLX,ACC,MR,NR,false>(dimk, c, ldc, a, lda, b, ldb, m);
+                }
+            }
+        };
+
+        template <typename V, bool CPLX, bool ACC, int NR>
+        struct MtxmqEdge<V,CPLX,ACC,0,NR> {
+            static void run(int, int, bool, long, double*, long, const double*, long,
+                            const double*, long, typename V::mask) {}
+        };
+
+        template <typename V, bool CPLX, bool ACC, int MR>
+        struct MtxmqEdge<V,CPLX,ACC,MR,0> {
+            static void run(int, int, bool, long, double*, long, const double*, long,
+                            const double*, long, typename V::mask) {}
+        };
+
+        template <typename V, bool CPLX, bool ACC>
+        struct MtxmqEdge<V,CPLX,ACC,0,0> {
+            static void run(int, int, bool, long, double*, long, const double*, long,
+                            const double*, long, typename V::mask) {}
+        };
+
+        /// c(i,j) (+)= sum(k) a(k,i)*b(k,j) with b(k,j) at b[k*ldb+j]
+
+        /// Dimensions and \c ldb count elements (complex numbers if \c CPLX).
+        /// The i loop is outermost so each strip of a is read once while all
+        /// of b, small in the intended application, stays in cache.
+        template <typename V, bool CPLX, bool ACC>
+        void mtxmq_driver(long dimi, long dimj, long dimk,
+                          double* c, const double* a, const double* b, long ldb) {
+            const int MR = CPLX ? V::MRZ : V::MR;
+            const int NR = CPLX ? V::NRZ : V::NR;
+            const long NA = CPLX ? 2 : 1;
+            const long nj = dimj*NA;   // doubles in a row of c
+            const long lda = dimi*NA;
+            ldb *= NA;
+
+            const int ntail = int(nj % V::W);
+            const typename V::mask m = V::make_mask(ntail ? ntail : V::W);
+            const long nfull = nj - nj % (NR*V::W);   // doubles covered by whole blocks
+            const int nv = int((nj - nfull + V::W - 1)/V::W);
+
+            for (long i=0; i<dimi; i+=MR) {
+                const int mr = (dimi-i < MR) ? int(dimi-i) : MR;
+                double* ci = c + i*nj;
+                const double* ai = a + i*NA;
+                for (long j=0; j<nfull; j+=NR*V::W) {
+                    if (mr == MR) {
+                        mtxmq_block<V,CPLX,ACC,MR,NR,false>(dimk, ci+j, nj, ai, lda, b+j, ldb, m);
+                    }
+                    else {
+                        MtxmqEdge<V,CPLX,ACC,MR,NR>::run(mr, NR, false, dimk, ci+j, nj, ai, lda, b+j, ldb, m);
+                    }
+                }
+                if (nv) {
+                    MtxmqEdge<V,CPLX,ACC,MR,NR>::run(mr, nv, ntail != 0, dimk, ci+nfull, nj,
+                                                 ai, lda, b+nfull, ldb, m);
+                }
+            }
+        }
+
+    }
+}
+
+#undef MADNESS_MTXMQ_UNROLL
+
+#endif // MADNESS_TENSOR_MTXMQ_KERNELS_H__INCLUDED
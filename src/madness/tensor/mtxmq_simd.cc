@@ -0,0 +1,167 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file tensor/mtxmq_simd.cc
+/// \brief Run-time selection of the SIMD mTxmq kernels
+
+#include <madness/madness_config.h>
+#include <madness/world/madness_exception.h>
+#include <madness/tensor/mxm.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace madness {
+    namespace detail {
+
+#ifdef MADNESS_MTXMQ_AVX2
+        void mtxmq_avx2(long dimi, long dimj, long dimk,
+                        double* c, const double* a, const double* b, long ldb, bool acc);
+        void mtxmq_avx2_complex(long dimi, long dimj, long dimk,
+                                double* c, const double* a, const double* b, long ldb, bool acc);
+#endif
+#ifdef MADNESS_MTXMQ_AVX512
+        void mtxmq_avx512(long dimi, long dimj, long dimk,
+                          double* c, const double* a, const double* b, long ldb, bool acc);
+        void mtxmq_avx512_complex(long dimi, long dimj, long dimk,
+                                  double* c, const double* a, const double* b, long ldb, bool acc);
+#endif
+
+        /// Largest dimj and dimk given to the kernels
+
+        /// Beyond this b no longer fits in L1 and the cache blocking of
+        /// BLAS wins
+        static const long MTXMQ_SIMD_MAXJK = 128;
+
+        /// The best kernels this build and CPU support
+        static MtxmqSimd mtxmq_simd_supported() {
+#if defined(MADNESS_MTXMQ_AVX512) || defined(MADNESS_MTXMQ_AVX2)
+            __builtin_cpu_init();
+#endif
+#ifdef MADNESS_MTXMQ_AVX512
+            if (__builtin_cpu_supports("avx512f")) return MtxmqSimd::avx512;
+#endif
+#ifdef MADNESS_MTXMQ_AVX2
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return MtxmqSimd::avx2;
+#endif
+            return MtxmqSimd::none;
+        }
+
+        /// Initially the best supported, capped by MAD_MTXMQ_SIMD
+        static std::atomic<int>& mtxmq_simd_current() {
+            static std::atomic<int> level([] {
+                MtxmqSimd s = mtxmq_simd_supported();
+                const char* env = std::getenv("MAD_MTXMQ_SIMD");
+                if (env) {
+                    MtxmqSimd want = MtxmqSimd::avx512;
+                    if (std::strcmp(env, "none") == 0 || std::strcmp(env, "0") == 0) want = MtxmqSimd::none;
+                    else if (std::strcmp(env, "avx2") == 0) want = MtxmqSimd::avx2;
+                    else if (std::strcmp(env, "avx512") != 0) {
+                        MADNESS_EXCEPTION("MAD_MTXMQ_SIMD must be one of none, avx2 or avx512", 0);
+                    }
+                    if (int(want) < int(s)) s = want;
+                }
+                return int(s);
+            }());
+            return level;
+        }
+
+        MtxmqSimd get_mtxmq_simd() {
+            return MtxmqSimd(mtxmq_simd_current().load(std::memory_order_relaxed));
+        }
+
+        MtxmqSimd set_mtxmq_simd(MtxmqSimd level) {
+            const MtxmqSimd s = mtxmq_simd_supported();
+            if (int(level) > int(s)) level = s;
+            mtxmq_simd_current() = int(level);
+            return level;
+        }
+
+        const char* mtxmq_simd_name(MtxmqSimd level) {
+            switch (level) {
+            case MtxmqSimd::avx2: return "avx2";
+            case MtxmqSimd::avx512: return "avx512";
+            default: return "none";
+            }
+        }
+
+        /// Dispatches to the kernels, on complex data viewed as pairs of doubles
+        static bool mtxmq_simd_doubles(bool cplx, long dimi, long dimj, long dimk,
+                                       double* c, const double* a, const double* b, long ldb, bool acc) {
+            if (dimj > MTXMQ_SIMD_MAXJK || dimk > MTXMQ_SIMD_MAXJK) return false;
+            switch (get_mtxmq_simd()) {
+#ifdef MADNESS_MTXMQ_AVX512
+            case MtxmqSimd::avx512:
+                if (cplx) mtxmq_avx512_complex(dimi, dimj, dimk, c, a, b, ldb, acc);
+                else mtxmq_avx512(dimi, dimj, dimk, c, a, b, ldb, acc);
+                return true;
+#endif
+#ifdef MADNESS_MTXMQ_AVX2
+            case MtxmqSimd::avx2:
+                if (cplx) mtxmq_avx2_complex(dimi, dimj, dimk, c, a, b, ldb, acc);
+                else mtxmq_avx2(dimi, dimj, dimk, c, a, b, ldb, acc);
+                return true;
+#endif
+            default:
+                return false;
+            }
+        }
+
+        // std::complex<double> is layout compatible with double[2]
+
+        bool mtxmq_simd(long dimi, long dimj, long dimk,
+                        double* MADNESS_RESTRICT c, const double* a, const double* b, long ldb) {
+            return mtxmq_simd_doubles(false, dimi, dimj, dimk, c, a, b, ldb, false);
+        }
+
+        bool mtxmq_simd(long dimi, long dimj, long dimk,
+                        std::complex<double>* MADNESS_RESTRICT c, const std::complex<double>* a,
+                        const std::complex<double>* b, long ldb) {
+            return mtxmq_simd_doubles(true, dimi, dimj, dimk, reinterpret_cast<double*>(c),
+                                      reinterpret_cast<const double*>(a),
+                                      reinterpret_cast<const double*>(b), ldb, false);
+        }
+
+        bool mtxm_simd(long dimi, long dimj, long dimk,
+                       double* MADNESS_RESTRICT c, const double* a, const double* b) {
+            return mtxmq_simd_doubles(false, dimi, dimj, dimk, c, a, b, dimj, true);
+        }
+
+        bool mtxm_simd(long dimi, long dimj, long dimk,
+                       std::complex<double>* MADNESS_RESTRICT c, const std::complex<double>* a,
+                       const std::complex<double>* b) {
+            return mtxmq_simd_doubles(true, dimi, dimj, dimk, reinterpret_cast<double*>(c),
+                                      reinterpret_cast<const double*>(a),
+                                      reinterpret_cast<const double*>(b), dimj, true);
+        }
+
+    }
+}
@@ -42,6 +42,7 @@
 //#ifdef HAVE_INTEL_MKL
 #include <madness/tensor/cblas.h>
 #endif
+#include <complex>
 
 /// \file tensor/mxm.h
 /// \brief Internal use only
@@ -56,6 +57,55 @@
 
 namespace madness {
 
+    namespace detail {
+
+        /// Instruction set of the SIMD mTxmq kernels (mtxmq_simd.cc)
+        enum class MtxmqSimd { none=0, avx2=1, avx512=2 };
+
+        /// Returns the kernels in use
+
+        /// Initially the best supported by the build and the CPU, capped by
+        /// the environment variable \c MAD_MTXMQ_SIMD
+        MtxmqSimd get_mtxmq_simd();
+
+        /// Selects the kernels, returning those actually used (capped by what is supported)
+        MtxmqSimd set_mtxmq_simd(MtxmqSimd level);
+
+        const char* mtxmq_simd_name(MtxmqSimd level);
+
+        /// Does \c c=a^T*b with the SIMD kernels if the shape suits them
+
+        /// Returns false, leaving \c c untouched, if there are no kernels
+        /// for this type, build or CPU, or if \c dimj or \c dimk is too
+        /// large for them to beat BLAS.
+        template <typename aT, typename bT, typename cT>
+        inline bool mtxmq_simd(long dimi, long dimj, long dimk,
+                               cT* MADNESS_RESTRICT c, const aT* a, const bT* b, long ldb) {
+            return false;
+        }
+
+        bool mtxmq_simd(long dimi, long dimj, long dimk,
+                        double* MADNESS_RESTRICT c, const double* a, const double* b, long ldb);
+
+        bool mtxmq_simd(long dimi, long dimj, long dimk,
+                        std::complex<double>* MADNESS_RESTRICT c, const std::complex<double>* a,
+                        const std::complex<double>* b, long ldb);
+
+        /// Does \c c+=a^T*b with the SIMD kernels if the shape suits them, as mtxmq_simd
+        template <typename aT, typename bT, typename cT>
+        inline bool mtxm_simd(long dimi, long dimj, long dimk,
+                              cT* MADNESS_RESTRICT c, const aT* a, const bT* b) {
+            return false;
+        }
+
+        bool mtxm_simd(long dimi, long dimj, long dimk,
+                       double* MADNESS_RESTRICT c, const double* a, const double* b);
+
+        bool mtxm_simd(long dimi, long dimj, long dimk,
+                       std::complex<double>* MADNESS_RESTRICT c, const std::complex<double>* a,
+                       const std::complex<double>* b);
+    }
+
     // Start with reference implementations.  Then provide optimized implementations, falling back to reference if not available on specific platforms
 
     /// Matrix \c += Matrix * matrix reference implementation (slow but correct)
@@ -206,6 +256,7 @@ namespace madness {
     template <typename T>
     void mTxm(long dimi, long dimj, long dimk,
               T* MADNESS_RESTRICT c, const T* a, const T* b) {
+        if (detail::mtxm_simd(dimi, dimj, dimk, c, a, b)) return;
         const T one = 1.0;  // alpha in *gemm
         cblas::gemm(cblas::NoTrans,cblas::Trans,dimj,dimi,dimk,one,b,dimj,a,dimi,one,c,dimj);
     }
@@ -255,6 +306,7 @@ namespace madness {
         MADNESS_ASSERT(ldb>=dimj);
 
         if (dimi==0 || dimj==0) return; // nothing to do and *GEMM will complain
+        if (detail::mtxmq_simd(dimi, dimj, dimk, c, a, b, ldb)) return;
         if (dimk==0) {
             for (long i=0; i<dimi*dimj; i++) c[i] = 0.0;
         }
@@ -288,6 +340,7 @@ namespace madness {
     template <typename aT, typename bT, typename cT>
     void mTxm(long dimi, long dimj, long dimk,
               cT* MADNESS_RESTRICT c, const aT* a, const bT* b) {
+        if (detail::mtxm_simd(dimi, dimj, dimk, c, a, b)) return;
         const cT one = 1.0;  // alpha in *gemm
         cblas::gemm(cblas::NoTrans,cblas::Trans,dimj,dimi,dimk,one,b,dimj,a,dimi,one,c,dimj);
     }
@@ -337,6 +390,7 @@ namespace madness {
         MADNESS_ASSERT(ldb>=dimj);
 
         if (dimi==0 || dimj==0) return; // nothing to do and *GEMM will complain
+        if (detail::mtxmq_simd(dimi, dimj, dimk, c, a, b, ldb)) return;
         if (dimk==0) {
             for (long i=0; i<dimi*dimj; i++) c[i] = 0.0;
         }
@@ -405,6 +459,7 @@ namespace madness {
           compared to 2/3 way unrolling (though not by much).
         */
         
+        if (detail::mtxm_simd(dimi, dimj, dimk, c, a, b)) return;
         long dimk4 = (dimk/4)*4;
         for (long i=0; i<dimi; ++i,c+=dimj) {
             const double* ai = a+i;
@@ -0,0 +1,222 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file tensor/scratch.cc
+/// \brief Per-thread scratch arenas
+
+#include <madness/tensor/scratch.h>
+#include <madness/world/madness_exception.h>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace madness {
+    namespace detail {
+        namespace {
+
+            const std::size_t A = ScratchArena::ALIGNMENT;
+            const std::size_t NONE = ~std::size_t(0);
+
+            class Arena;
+
+            /// Precedes every block, padded to the alignment
+            struct Header {
+                Arena* arena;       ///< Owner, or 0 for a block from the heap
+                std::size_t prev;   ///< Offset of the header of the block below in the chunk, or NONE
+                std::size_t size;   ///< Bytes including the header
+                int chunk;          ///< Index of the chunk
+                bool freed;
+            };
+            static_assert(sizeof(Header) <= A, "scratch header does not fit the alignment");
+
+            /// Chunk size in bytes, read once from MAD_SCRATCH_ARENA
+            std::size_t chunk_size() {
+                static const std::size_t size = [] {
+                    const char* s = std::getenv("MAD_SCRATCH_ARENA");
+                    const long mb = s ? std::atol(s) : 8;
+                    return std::size_t(mb > 0 ? mb : 0) << 20;
+                }();
+                return size;
+            }
+
+            void* heap_allocate(std::size_t nbyte) {
+                void* p;
+                if (posix_memalign(&p, A, nbyte)) throw std::bad_alloc();
+                return p;
+            }
+
+            std::mutex registry_mutex;
+            std::vector<Arena*> registry;   ///< Arenas of the running threads
+            ScratchStats exited = {0, 0, 0, 0};
+
+            /// Stack of chunks belonging to one thread
+            class Arena {
+                struct Chunk {
+                    char* base;
+                    std::size_t top;    ///< First free byte
+                    std::size_t last;   ///< Offset of the header of the top block, or NONE
+                };
+
+                std::vector<Chunk> chunks;  ///< Only chunks[0..cur] hold blocks
+                int cur = -1;
+                std::size_t inuse = 0;
+
+                /// Written by the owner only, read by stats()
+                std::atomic<unsigned long> nalloc{0}, nheap{0}, nchunk{0}, max_bytes{0};
+
+                static void bump(std::atomic<unsigned long>& n) {
+                    n.store(n.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+                }
+
+                Header* header(int c, std::size_t off) const {
+                    return reinterpret_cast<Header*>(chunks[c].base + off);
+                }
+
+            public:
+                bool destroyed = false;
+
+                Arena() {
+                    std::lock_guard<std::mutex> lock(registry_mutex);
+                    registry.push_back(this);
+                }
+
+                ~Arena() {
+                    {
+                        std::lock_guard<std::mutex> lock(registry_mutex);
+                        add_to(exited);
+                        for (std::size_t i=0; i<registry.size(); ++i) {
+                            if (registry[i] == this) {
+                                registry[i] = registry.back();
+                                registry.pop_back();
+                                break;
+                            }
+                        }
+                    }
+                    for (Chunk& c : chunks) std::free(c.base);
+                    destroyed = true;
+                }
+
+                void add_to(ScratchStats& s) const {
+                    s.nalloc += nalloc.load(std::memory_order_relaxed);
+                    s.nheap += nheap.load(std::memory_order_relaxed);
+                    s.nchunk += nchunk.load(std::memory_order_relaxed);
+                    const unsigned long m = max_bytes.load(std::memory_order_relaxed);
+                    if (m > s.max_bytes) s.max_bytes = m;
+                }
+
+                void* allocate(std::size_t nbyte) {
+                    const std::size_t n = A + (nbyte + A - 1)/A*A;
+                    const std::size_t csize = chunk_size();
+                    Header* h;
+                    if (n > csize/2) {
+                        h = static_cast<Header*>(heap_allocate(n));
+                        h->arena = 0;
+                        bump(nheap);
+                        return reinterpret_cast<char*>(h) + A;
+                    }
+                    if (cur < 0 || chunks[cur].top + n > csize) {
+                        // Chunks above cur are empty
+                        if (++cur == int(chunks.size())) {
+                            chunks.push_back(Chunk{static_cast<char*>(heap_allocate(csize)), 0, NONE});
+                            bump(nchunk);
+                        }
+                    }
+                    Chunk& c = chunks[cur];
+                    h = header(cur, c.top);
+                    h->arena = this;
+                    h->prev = c.last;
+                    h->size = n;
+                    h->chunk = cur;
+                    h->freed = false;
+                    c.last = c.top;
+                    c.top += n;
+
+                    inuse += n;
+                    if (inuse > max_bytes.load(std::memory_order_relaxed))
+                        max_bytes.store(inuse, std::memory_order_relaxed);
+                    bump(nalloc);
+                    return reinterpret_cast<char*>(h) + A;
+                }
+
+                void release(Header* h) {
+                    h->freed = true;
+                    inuse -= h->size;
+                    // Pop freed blocks off the top, stepping down as chunks empty
+                    while (true) {
+                        Chunk& c = chunks[cur];
+                        while (c.last != NONE) {
+                            const Header* t = header(cur, c.last);
+                            if (!t->freed) return;
+                            c.top = c.last;
+                            c.last = t->prev;
+                        }
+                        if (cur == 0) return;
+                        --cur;
+                    }
+                }
+            };
+
+            thread_local Arena arena;
+
+        } // namespace
+
+        void* ScratchArena::allocate(std::size_t nbyte) {
+            Arena& a = arena;
+            if (a.destroyed) {
+                Header* h = static_cast<Header*>(heap_allocate(A + nbyte));
+                h->arena = 0;
+                return reinterpret_cast<char*>(h) + A;
+            }
+            return a.allocate(nbyte);
+        }
+
+        void ScratchArena::release(void* p) {
+            if (!p) return;
+            Header* h = reinterpret_cast<Header*>(static_cast<char*>(p) - A);
+            if (!h->arena) {
+                std::free(h);
+                return;
+            }
+            MADNESS_ASSERT(h->arena == &arena);
+            h->arena->release(h);
+        }
+
+        ScratchStats ScratchArena::stats() {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            ScratchStats s = exited;
+            for (const Arena* a : registry) a->add_to(s);
+            return s;
+        }
+
+    } // namespace detail
+} // namespace madness
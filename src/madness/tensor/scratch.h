@@ -0,0 +1,90 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_TENSOR_SCRATCH_H__INCLUDED
+#define MADNESS_TENSOR_SCRATCH_H__INCLUDED
+
+/// \file tensor/scratch.h
+/// \brief Per-thread stack of aligned memory for short-lived workspace
+
+// Workspace in the inner loops of operator application and of the
+// twoscale transforms lives for one call, yet taking it from the heap
+// costs a posix_memalign and a free every time.  Each thread instead
+// keeps a stack of large chunks and cuts blocks from the top of it.
+// A block freed by its thread goes back to the stack as soon as all
+// blocks above it are freed too, so scope exit, which frees in the
+// reverse order of allocation, reclaims everything at once.  Requests
+// larger than half a chunk go to the heap.  Chunks are kept until the
+// thread exits.
+//
+// The chunk size in MB is read from the environment variable
+// MAD_SCRATCH_ARENA when first used (default 8); 0 sends all requests
+// to the heap.
+
+#include <cstddef>
+
+namespace madness {
+
+    /// Statistics of the scratch arenas summed over all threads
+    struct ScratchStats {
+        unsigned long nalloc;      ///< Blocks cut from the arenas
+        unsigned long nheap;       ///< Requests passed to the heap
+        unsigned long nchunk;      ///< Chunks taken from the heap
+        unsigned long max_bytes;   ///< Most bytes in use at once by one thread
+    };
+
+    namespace detail {
+
+        /// Entry points of the scratch arena of the calling thread
+        class ScratchArena {
+        public:
+            static const std::size_t ALIGNMENT = 64; ///< Alignment of all blocks
+
+            /// Allocates nbyte bytes ... free with release() on the same thread
+            static void* allocate(std::size_t nbyte);
+
+            /// Frees a block from allocate()
+            static void release(void* p);
+
+            /// Returns the statistics
+            static ScratchStats stats();
+        };
+
+    } // namespace detail
+
+    /// Returns the statistics of the scratch arenas
+    inline ScratchStats scratch_stats() {
+        return detail::ScratchArena::stats();
+    }
+
+} // namespace madness
+
+#endif // MADNESS_TENSOR_SCRATCH_H__INCLUDED
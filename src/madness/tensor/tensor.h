@@ -44,6 +44,9 @@
 #include <cstddef>
 
 #include <madness/world/archive.h>
+#include <madness/world/buffer_archive.h>
+#include <madness/world/pool_alloc.h>
+#include <madness/world/atomicint.h>
 // #include <madness/world/print.h>
 //
 // typedef std::complex<float> float_complex;
@@ -57,6 +60,7 @@
 #include <madness/tensor/basetensor.h>
 #include <madness/tensor/aligned.h>
 #include <madness/tensor/mxm.h>
+#include <madness/tensor/scratch.h>
 #include <madness/tensor/tensorexcept.h>
 #include <madness/tensor/tensoriter.h>
 
@@ -284,36 +288,77 @@ namespace madness {
     }
 
     //#define TENSOR_USE_SHARED_ALIGNED_ARRAY
+#if defined(MADNESS_TENSOR_POOL_STORAGE) && !defined(TENSOR_USE_SHARED_ALIGNED_ARRAY)
+#define TENSOR_USE_SHARED_ALIGNED_ARRAY
+#endif
 #ifdef TENSOR_USE_SHARED_ALIGNED_ARRAY
 #define TENSOR_SHARED_PTR detail::SharedAlignedArray
     // this code has been tested and seems to work correctly on all
     // tests and moldft ... however initial testing indicated a hard
     // to measure improvement in thread scaling (from 20 to 60 threads
     // on cn-mem) and no change in the modest thread count (20)
-    // execution time with tbballoc.  hence we are not presently using
-    // it but will test more in the future with different allocators
+    // execution time with tbballoc.  it is now used (configure with
+    // ENABLE_TENSOR_POOL_STORAGE) together with the pool allocator,
+    // which serves the many tiny tensors (1-d coefficients, rnlij
+    // blocks, norms, quadrature points) from per-thread free lists.
     namespace detail {
-        // Minimal ref-counted array with data+counter in one alloc
+        // Minimal ref-counted array with data+counter in one alloc.  The
+        // counter sits in a header just before the aligned data.  Arrays
+        // of up to SMALL bytes come from the pool.  An array given to
+        // set_unowned() has no counter and is never freed.
         template <typename T> class SharedAlignedArray {
-            T* volatile p;
-            AtomicInt* cnt;
-            void dec() {if (p && ((*cnt)-- == 1)) {free(p); p = 0;}}
-            void inc() {if (p) (*cnt)++;}
+            struct Header {
+                AtomicInt cnt;
+                unsigned int offset;  // bytes from the start of the allocation to the data
+                std::size_t nbyte;    // bytes taken from the pool, or 0 if from the heap
+            };
+
+            T* p;
+            Header* h;
+
+            void dec() {
+                if (h && ((h->cnt)-- == 1)) {
+                    char* base = reinterpret_cast<char*>(p) - h->offset;
+                    if (h->nbyte) pool_deallocate(base, h->nbyte);
+                    else free(base);
+                }
+                p = 0;
+                h = 0;
+            }
+            void inc() {if (h) (h->cnt)++;}
+
         public:
-            SharedAlignedArray() : p(0), cnt(0) {}
+            static const std::size_t SMALL = 4096;
+
+            SharedAlignedArray() : p(0), h(0) {}
+            SharedAlignedArray(const SharedAlignedArray<T>& other) : p(other.p), h(other.h) {inc();}
             T* allocate(std::size_t size, unsigned int alignment) {
-                std::size_t offset = (size*sizeof(T)-1)/sizeof(AtomicInt) + 1; // Where the counter will be
-                std::size_t nbyte = (offset+1)*sizeof(AtomicInt);
-                if (posix_memalign((void **) &p, alignment, nbyte)) throw 1;
-                cnt = (AtomicInt*)(p) + offset;
-                *cnt = 1;
+                dec();
+                // alignment is at least sizeof(Header), so this leaves room for it
+                const std::size_t nbyte = size*sizeof(T) + alignment;
+                char* base;
+                std::size_t pooled = 0;
+                if (size*sizeof(T) <= SMALL) {
+                    base = static_cast<char*>(pool_allocate(nbyte));
+                    pooled = nbyte;
+                }
+                else if (posix_memalign((void **) &base, alignment, nbyte)) {
+                    throw 1;
+                }
+                const std::size_t start = reinterpret_cast<std::size_t>(base) + sizeof(Header);
+                p = reinterpret_cast<T*>((start + alignment - 1)/alignment*alignment);
+                h = reinterpret_cast<Header*>(p) - 1;
+                h->cnt = 1;
+                h->offset = reinterpret_cast<char*>(p) - base;
+                h->nbyte = pooled;
                 return p;
             }
+            void set_unowned(T* ptr) {dec(); p = ptr;}
             SharedAlignedArray<T>& operator=(const SharedAlignedArray<T>& other) {
-                if (this != &other) {dec(); p = other.p; cnt = other.cnt; inc();}
+                if (this != &other) {dec(); p = other.p; h = other.h; inc();}
                 return *this;
             }
-            void reset() {dec(); p = 0;}
+            void reset() {dec();}
             ~SharedAlignedArray() {dec();}
         };
     }
@@ -1881,6 +1926,54 @@ namespace madness {
 
     };
 
+    /// A tensor in the scratch arena of the calling thread
+
+    /// \ingroup tensor
+    /// Workspace for the duration of one scope: the memory goes back to
+    /// the arena (see scratch.h) when the ScratchTensor is destroyed.
+    /// Hence it must be destroyed by the thread that made it, and no
+    /// shallow copy of it may outlive it.  It cannot itself be copied or
+    /// assigned, but can be passed wherever a \c Tensor<T>& is expected.
+    template <class T> class ScratchTensor : public Tensor<T> {
+        T* _scratch;
+
+    public:
+        /// Makes a tensor with nd dimensions d[], zeroed only if \c dozero
+        ScratchTensor(long nd, const long d[], bool dozero=false) : _scratch(0) {
+            TENSOR_ASSERT(nd>0 && nd <= TENSOR_MAXDIM,"invalid ndim in new tensor", nd, 0);
+            this->set_dims_and_size(nd, d);
+            if (this->_size) {
+                _scratch = static_cast<T*>(detail::ScratchArena::allocate(sizeof(T)*this->_size));
+                this->_p = _scratch;
+                // Owns nothing, so copies never free the memory
+#ifdef TENSOR_USE_SHARED_ALIGNED_ARRAY
+                this->_shptr.set_unowned(_scratch);
+#else
+                this->_shptr = std::shared_ptr<T>(std::shared_ptr<T>(), _scratch);
+#endif
+                if (dozero) {
+#ifdef HAVE_MEMSET
+                    memset((void *) this->_p, 0, this->_size*sizeof(T));
+#else
+                    aligned_zero(this->_size, this->_p);
+#endif
+                }
+            }
+        }
+
+        /// Makes a tensor with dimensions d, zeroed only if \c dozero
+        explicit ScratchTensor(const std::vector<long>& d, bool dozero=false)
+            : ScratchTensor(long(d.size()), d.data(), dozero) {}
+
+        ScratchTensor(const ScratchTensor<T>&) = delete;
+        ScratchTensor<T>& operator=(const ScratchTensor<T>&) = delete;
+
+        ~ScratchTensor() {
+            this->deallocate();
+            detail::ScratchArena::release(_scratch);
+        }
+    };
+
     template <class T>
     std::ostream& operator << (std::ostream& out, const Tensor<T>& t);
 
@@ -1921,6 +2014,67 @@ namespace madness {
             };
         };
 
+        /// Serialize a tensor into a buffer ... large data may travel beside the buffer
+
+        /// If the buffer allows it (e.g., an active message made with
+        /// \c new_am_arg_bulk) data of at least the threshold size is not
+        /// copied but sent straight from the tensor, which must then not
+        /// be modified in place until the message has been sent.
+        template <typename T>
+        struct ArchiveStoreImpl< BufferOutputArchive, Tensor<T> > {
+            static void store(const BufferOutputArchive& s, const Tensor<T>& t) {
+                if (t.iscontiguous()) {
+                    s & t.size() & t.id();
+                    if (t.size()) {
+                        s & t.ndim() & wrap(t.dims(),TENSOR_MAXDIM);
+                        if (s.has_bulk()) {
+                            const std::size_t nbyte = t.size()*sizeof(T);
+                            const bool bulk = s.is_bulk(nbyte);
+                            s & bulk;
+                            if (bulk) {
+                                s & s.store_bulk(t.ptr(), nbyte, std::make_shared<const Tensor<T> >(t));
+                                return;
+                            }
+                        }
+                        s & wrap(t.ptr(),t.size());
+                    }
+                }
+                else {
+                    s & copy(t);
+                }
+            };
+        };
+
+
+        /// Deserialize a tensor from a buffer ... large data is received straight into the new tensor
+        template <typename T>
+        struct ArchiveLoadImpl< BufferInputArchive, Tensor<T> > {
+            static void load(const BufferInputArchive& s, Tensor<T>& t) {
+                long sz = 0l, id = 0l;
+                s & sz & id;
+                if (id != t.id()) throw "type mismatch deserializing a tensor";
+                if (sz) {
+                    long _ndim = 0l, _dim[TENSOR_MAXDIM];
+                    s & _ndim & wrap(_dim,TENSOR_MAXDIM);
+                    t = Tensor<T>(_ndim, _dim, false);
+                    if (sz != t.size()) throw "size mismatch deserializing a tensor";
+                    bool bulk = false;
+                    if (s.has_bulk()) s & bulk;
+                    if (bulk) {
+                        unsigned long bulkid = 0;
+                        s & bulkid;
+                        s.load_bulk(bulkid, t.ptr(), t.size()*sizeof(T));
+                    }
+                    else {
+                        s & wrap(t.ptr(), t.size());
+                    }
+                }
+                else {
+                    t = Tensor<T>();
+                }
+            };
+        };
+
     }
 
     /// The class defines tensor op scalar ... here define scalar op tensor.
@@ -2359,7 +2513,7 @@ namespace madness {
         TENSOR_ASSERT(c.ndim() == 2,"second argument must be a matrix",c.ndim(),&c);
         if (c.dim(0)==c.dim(1) && t.iscontiguous() && c.iscontiguous()) {
             Tensor<resultT> result(t.ndim(),t.dims(),false);
-            Tensor<resultT> work(t.ndim(),t.dims(),false);
+            ScratchTensor<resultT> work(t.ndim(),t.dims());
             return fast_transform(t, c, result, work);
         }
         else {
@@ -2384,9 +2538,40 @@ namespace madness {
     template <class T, class Q>
     Tensor<TENSOR_RESULT_TYPE(T,Q)> general_transform(const Tensor<T>& t, const Tensor<Q> c[]) {
         typedef TENSOR_RESULT_TYPE(T,Q) resultT;
-        Tensor<resultT> result = t;
-        for (long i=0; i<t.ndim(); ++i) {
-            result = inner(result,c[i],0,0);
+        const long nd = t.ndim();
+        bool contiguous = t.iscontiguous() && t.size()>0;
+        for (long i=0; i<nd; ++i) contiguous = contiguous && c[i].ndim()==2 && c[i].iscontiguous();
+        if (!contiguous) {
+            Tensor<resultT> result = t;
+            for (long i=0; i<nd; ++i) {
+                result = inner(result,c[i],0,0);
+            }
+            return result;
+        }
+
+        // Each step contracts the leading index and appends the new one
+        // last, as inner(result,c[i],0,0) does.  All but the last product
+        // go to scratch.
+        long d[TENSOR_MAXDIM], size=t.size(), maxsize=0;
+        for (long i=0; i<nd; ++i) {
+            TENSOR_ASSERT(t.dim(i) == c[i].dim(0),"common index must be same length",c[i].dim(0),&t);
+            d[i] = c[i].dim(1);
+            size = size/t.dim(i)*d[i];
+            if (i < nd-1) maxsize = std::max(maxsize,size);
+        }
+        Tensor<resultT> result(nd,d,false);
+        const long nwork = 2*maxsize;
+        ScratchTensor<resultT> work(1,&nwork);
+
+        resultT* w = (nd==1) ? result.ptr() : work.ptr();
+        size = t.size();
+        mTxmq(size/t.dim(0), d[0], t.dim(0), w, t.ptr(), c[0].ptr());
+        size = size/t.dim(0)*d[0];
+        for (long i=1; i<nd; ++i) {
+            const resultT* prev = w;
+            w = (i==nd-1) ? result.ptr() : work.ptr() + (i%2)*maxsize;
+            mTxmq(size/t.dim(i), d[i], t.dim(i), w, prev, c[i].ptr());
+            size = size/t.dim(i)*d[i];
         }
         return result;
     }
@@ -57,11 +57,14 @@ bool smalltest = false;
 using namespace madness;
 
 
+typedef std::complex<double> double_complex;
+
 #define TIME_DGEMM
 #ifdef TIME_DGEMM
 
-void mTxm_dgemm(long ni, long nj, long nk, double* c, const double* a, const double*b ) {
-  double one=1.0;
+template <typename T>
+void mTxm_dgemm(long ni, long nj, long nk, T* c, const T* a, const T*b ) {
+  T one=1.0;
   cblas::gemm(cblas::NoTrans,cblas::Trans,nj,ni,nk,one,b,nj,a,ni,one,c,nj);
 }
 
@@ -80,13 +83,59 @@ void ran_fill(int n, double *a) {
     while (n--) *a++ = ran();
 }
 
+void ran_fill(int n, double_complex *a) {
+    while (n--) {
+        double re = ran();
+        *a++ = double_complex(re, ran());
+    }
+}
+
+template <typename T>
 void mTxm(long dimi, long dimj, long dimk,
-          double* c, const double* a, const double* b) {
+          T* c, const T* a, const T* b, long ldb) {
     int i, j, k;
     for (k=0; k<dimk; ++k) {
         for (j=0; j<dimj; ++j) {
             for (i=0; i<dimi; ++i) {
-                c[i*dimj+j] += a[k*dimi+i]*b[k*dimj+j];
+                c[i*dimj+j] += a[k*dimi+i]*b[k*ldb+j];
+            }
+        }
+    }
+}
+
+/// Compares mTxmq and mTxm with the simple loop above for all shapes up to nmax
+template <typename T>
+void check(long nmax, long ldb_extra, T* a, T* b, T* c, T* d) {
+    for (long ni=1; ni<nmax; ni+=1) {
+        for (long nj=1; nj<nmax; nj+=1) {
+            for (long nk=1; nk<nmax; nk+=1) {
+                const long ldb = nj + ldb_extra;
+                for (long i=0; i<ni*nj; ++i) d[i] = c[i] = 0.0;
+                mTxm (ni,nj,nk,c,a,b,ldb);
+                mTxmq(ni,nj,nk,d,a,b,ldb);
+                for (long i=0; i<ni*nj; ++i) {
+                    double err = std::abs(d[i]-c[i]);
+                    /* This test is sensitive to the compilation options.
+                       Be sure to have the reference code above compiled
+                       -msse2 -fpmath=sse if using GCC.  Otherwise, to
+                       pass the test you may need to change the threshold
+                       to circa 1e-13.
+                    */
+                    if (err > 1e-13) {
+                        printf("test_mtxmq: error %ld %ld %ld %ld %e\n",ni,nj,nk,ldb,err);
+                        exit(1);
+                    }
+                }
+                // mTxm accumulates into c
+                if (ldb == nj) {
+                    madness::mTxm(ni,nj,nk,d,a,b);
+                    for (long i=0; i<ni*nj; ++i) {
+                        if (std::abs(d[i]-2.0*c[i]) > 2e-13) {
+                            printf("test_mtxmq: mTxm error %ld %ld %ld %e\n",ni,nj,nk,std::abs(d[i]-2.0*c[i]));
+                            exit(1);
+                        }
+                    }
+                }
             }
         }
     }
@@ -97,10 +146,12 @@ void crap(double rate, double fastest, double start) {
 }
 
 
-void timer(const char* s, long ni, long nj, long nk, double *a, double *b, double *c) {
+/// Prints GFLOP/s of mTxmq (SIMD kernels if selected) and of BLAS
+template <typename T>
+void timer(const char* s, long ni, long nj, long nk, T *a, T *b, T *c) {
   double fastest=0.0, fastest_dgemm=0.0;
 
-  double nflop = 2.0*ni*nj*nk;
+  double nflop = (sizeof(T)/sizeof(double))*(sizeof(T)/sizeof(double))*2.0*ni*nj*nk;
   long loop;
   for (int t=0; t<100; t++) {
     double rate;
@@ -174,8 +225,9 @@ int main(int argc, char * argv[]) {
     const long nimax=!smalltest ? 30*30 : 8*8;
     const long njmax=!smalltest ? 100 : 20;
     const long nkmax=!smalltest ? 100 : 20;
-    long ni, nj, nk, i, m;
+    long ni, m;
     double *a, *b, *c, *d;
+    double_complex *za, *zb, *zc, *zd;
 
     SafeMPI::Init_thread(argc, argv, MPI_THREAD_SINGLE);
 
@@ -183,54 +235,39 @@ int main(int argc, char * argv[]) {
     posix_memalign((void **) &b, 16, nkmax*njmax*sizeof(double));
     posix_memalign((void **) &c, 16, nimax*njmax*sizeof(double));
     posix_memalign((void **) &d, 16, nimax*njmax*sizeof(double));
+    posix_memalign((void **) &za, 16, nkmax*nimax*sizeof(double_complex));
+    posix_memalign((void **) &zb, 16, nkmax*njmax*sizeof(double_complex));
+    posix_memalign((void **) &zc, 16, nimax*njmax*sizeof(double_complex));
+    posix_memalign((void **) &zd, 16, nimax*njmax*sizeof(double_complex));
 
     ran_fill(nkmax*nimax, a);
     ran_fill(nkmax*njmax, b);
-
-
-/*     ni = nj = nk = 2; */
-/*     for (i=0; i<ni*nj; ++i) d[i] = c[i] = 0.0; */
-/*     mTxm (ni,nj,nk,c,a,b); */
-/*     mTxmq(ni,nj,nk,d,a,b); */
-/*     for (i=0; i<ni; ++i) { */
-/*       long j; */
-/*       for (j=0; j<nj; ++j) { */
-/* 	printf("%2ld %2ld %.6f %.6f\n", i, j, c[i*nj+j], d[i*nj+j]); */
-/*       } */
-/*     } */
-/*     return 0; */
-
-    printf("Starting to test ... \n");
-    for (ni=1; ni<std::min(60L,nimax); ni+=1) {
-        for (nj=1; nj<std::min(60L,njmax); nj+=1) {
-            for (nk=1; nk<std::min(60L,nkmax); nk+=1) {
-                for (i=0; i<ni*nj; ++i) d[i] = c[i] = 0.0;
-                mTxm (ni,nj,nk,c,a,b);
-                mTxmq(ni,nj,nk,d,a,b);
-                for (i=0; i<ni*nj; ++i) {
-                    double err = std::abs(d[i]-c[i]);
-                    /* This test is sensitive to the compilation options.
-                       Be sure to have the reference code above compiled
-                       -msse2 -fpmath=sse if using GCC.  Otherwise, to
-                       pass the test you may need to change the threshold
-                       to circa 1e-13.
-                    */
-                    if (err > 1e-13) {
-                        printf("test_mtxmq: error %ld %ld %ld %e\n",ni,nj,nk,err);
-                        exit(1);
-                    }
-                }
-            }
-        }
+    ran_fill(nkmax*nimax, za);
+    ran_fill(nkmax*njmax, zb);
+
+    // Every kernel this build and CPU support, then BLAS alone
+    const detail::MtxmqSimd best = detail::set_mtxmq_simd(detail::MtxmqSimd::avx512);
+    for (int level=int(best); level>=0; --level) {
+        detail::set_mtxmq_simd(detail::MtxmqSimd(level));
+        printf("Starting to test %s ... \n", detail::mtxmq_simd_name(detail::MtxmqSimd(level)));
+        check(std::min(60L,njmax), 0, a, b, c, d);
+        check(std::min(16L,njmax), 3, a, b, c, d);
+        check(std::min(20L,njmax), 0, za, zb, zc, zd);
+        check(std::min(12L,njmax), 1, za, zb, zc, zd);
+        printf("... OK!\n");
     }
-    printf("... OK!\n");
+    detail::set_mtxmq_simd(best);
 
     if (!smalltest) {
-        printf("%20s %3s %3s %3s %8s %8s (GF/s)\n", "type", "M", "N", "K", "LOOP", "BLAS");
+        printf("%20s %3s %3s %3s %8s %8s (GF/s)\n", "type", "M", "N", "K",
+               detail::mtxmq_simd_name(best), "BLAS");
         for (ni=2; ni<60; ni+=2) timer("(m*m)T*(m*m)", ni,ni,ni,a,b,c);
         for (m=2; m<=30; m+=2) timer("(m*m,m)T*(m*m)", m*m,m,m,a,b,c);
+        for (m=2; m<=20; m+=2) timer("(m*m,2m)T*(2m,2m)", m*m,2*m,2*m,a,b,c);
         for (m=2; m<=30; m+=2) trantimer("tran(m,m,m)", m*m,m,m,a,b,c);
         for (m=2; m<=20; m+=2) timer("(20*20,20)T*(20,m)", 20*20,m,20,a,b,c);
+        for (m=2; m<=30; m+=2) timer("Z(m*m,m)T*(m*m)", m*m,m,m,za,zb,zc);
+        for (m=2; m<=20; m+=2) timer("Z(m*m,2m)T*(2m,2m)", m*m,2*m,2*m,za,zb,zc);
     }
 
     SafeMPI::Finalize();
@@ -45,6 +45,7 @@ using madness::___;
 using madness::_reverse;
 
 #include <iostream>
+#include <thread>
 #include <gtest/gtest.h>
 
 namespace {
@@ -415,6 +416,74 @@ namespace {
         ITERATOR3(b,ASSERT_EQ(b(_i,_j,_k), a(_j,_i,_k)));
     }
 
+    TEST(TensorStorageTest, SmallAndLarge) {
+        // Around the size at which storage moves from the pool to the heap
+        std::vector< madness::Tensor<double> > v;
+        for (long n=1; n<=1100; n+=(n<500 ? 37 : 1)) {
+            madness::Tensor<double> t(n);
+            ASSERT_EQ(long(t.ptr()) % TENSOR_ALIGNMENT, 0);
+            t.fillindex();
+            v.push_back(t);
+        }
+        // The last reference is dropped by another thread
+        std::thread([&v] {
+            for (madness::Tensor<double>& t : v) {
+                madness::Tensor<double> u = t;
+                t = madness::Tensor<double>();
+                long i = 0;
+                ITERATOR(u, ASSERT_EQ(u(IND), double(i++)));
+            }
+        }).join();
+        for (const madness::Tensor<double>& t : v) ASSERT_EQ(t.size(), 0);
+    }
+
+    TEST(ScratchTensorTest, Stack) {
+        const madness::ScratchStats before = madness::scratch_stats();
+        const long d[3] = {5, 6, 7};
+        madness::ScratchTensor<double> a(3, d, true);
+        ITERATOR(a, ASSERT_EQ(a(IND), 0.0));
+        ASSERT_EQ(long(a.ptr()) % madness::detail::ScratchArena::ALIGNMENT, 0);
+        // Not if MAD_SCRATCH_ARENA=0 sends all blocks to the heap
+        const bool stack = madness::scratch_stats().nalloc > before.nalloc;
+        a.fillindex();
+        const double* pb;
+        {
+            madness::ScratchTensor<double> b(std::vector<long>(2,9));
+            pb = b.ptr();
+            madness::ScratchTensor<double>* c = new madness::ScratchTensor<double>(3, d);
+            madness::ScratchTensor<double> e(3, d);
+            if (stack) {
+                ASSERT_GT(e.ptr(), c->ptr());
+                ASSERT_GT(c->ptr(), pb);
+            }
+            delete c;   // below e, so reclaimed with e
+        }
+        {
+            // b, c and e were all reclaimed
+            madness::ScratchTensor<double> b(std::vector<long>(2,9));
+            if (stack) ASSERT_EQ(b.ptr(), pb);
+        }
+        long i = 0;
+        ITERATOR(a, ASSERT_EQ(a(IND), double(i++)));
+        ASSERT_EQ(madness::scratch_stats().nalloc + madness::scratch_stats().nheap,
+                  before.nalloc + before.nheap + 5);
+    }
+
+    TEST(ScratchTensorTest, GeneralTransform) {
+        madness::Tensor<double> t(4,5,6), c[3];
+        t.fillrandom();
+        for (int i=0; i<3; ++i) {
+            c[i] = madness::Tensor<double>(t.dim(i), 3+2*i);
+            c[i].fillrandom();
+        }
+        madness::Tensor<double> r = madness::general_transform(t, c);
+        madness::Tensor<double> s = t;
+        for (int i=0; i<3; ++i) s = madness::inner(s, c[i], 0, 0);
+        ASSERT_EQ(r.ndim(), 3);
+        for (int i=0; i<3; ++i) ASSERT_EQ(r.dim(i), 3+2*i);
+        ASSERT_LT((r-s).normf(), 1e-13*s.normf());
+    }
+
 //     TYPED_TEST(TensorTest, Container) {
 //         typedef madness::ConcurrentHashMap< int, Tensor<TypeParam> > containerT;
 //         static const int N = 100;
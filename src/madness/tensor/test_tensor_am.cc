@@ -0,0 +1,155 @@
+#define WORLD_INSTANTIATE_STATIC_TEMPLATES
+
+#include <madness/madness_config.h>
+#include <madness/world/MADworld.h>
+#include <madness/world/worlddc.h>
+#include <madness/tensor/tensor.h>
+#include <cstring>
+#include <vector>
+
+/// \file test_tensor_am.cc
+/// \brief Tests tensors in active messages, including those sent beside the message
+
+using namespace madness;
+
+std::atomic<long> nreceived{0};
+
+double value(long n, long i) { return n*1000.0 + i; }
+
+/// Makes a tensor of n elements, or a non-contiguous slice of one if n is odd
+Tensor<double> make(long n) {
+    if (n == 0) return Tensor<double>();
+    Tensor<double> t(2*n);
+    for (long i=0; i<2*n; ++i) t[i] = (n%2) ? value(n, i/2) : value(n, i);
+    return (n%2) ? Tensor<double>(t(Slice(0,-1,2))) : Tensor<double>(t(Slice(0,n-1)));
+}
+
+const long sizes[] = {0l, 1l, 100l, 511l, 512l, 513l, 4096l, 100001l};
+
+Tensor<double> make_small() {
+    Tensor<double> u(3);
+    u[0] = 1.0; u[1] = 2.0; u[2] = 3.0;
+    return u;
+}
+
+void check(long n, const Tensor<double>& t, const Tensor<double>& u) {
+    MADNESS_CHECK(t.size() == n && (n == 0 || t.iscontiguous()));
+    for (long i=0; i<n; ++i) MADNESS_CHECK(t[i] == value(n, i));
+    MADNESS_CHECK(u.size() == 3 && u[2] == 3.0);
+}
+
+/// Blocks kept beside a buffer, standing in for messages
+std::vector< std::pair<const void*, std::shared_ptr<const void> > > blocks;
+
+unsigned long put_block(void*, const void* p, std::size_t, std::shared_ptr<const void> keeper) {
+    blocks.emplace_back(p, std::move(keeper));
+    return blocks.size() - 1;
+}
+
+void get_block(const void*, unsigned long id, void* p, std::size_t nbyte) {
+    std::memcpy(p, blocks.at(id).first, nbyte);
+    blocks[id].second.reset();
+}
+
+/// Checks the layout of tensors in buffers with blocks beside them
+void test_archive() {
+    std::vector<unsigned char> buf(65536);
+    for (long n : sizes) {
+        blocks.clear();
+        archive::BufferOutputArchive oar(buf.data(), buf.size());
+        oar.set_bulk(put_block, 4096);
+        Tensor<double> t = make(n);
+        oar & n & t & make_small();
+        t = Tensor<double>();
+        MADNESS_CHECK(blocks.size() == (n*sizeof(double) >= 4096 ? 1u : 0u));
+
+        archive::BufferInputArchive iar(buf.data(), oar.size(), get_block, nullptr);
+        long m;
+        Tensor<double> u;
+        iar & m & t & u;
+        MADNESS_CHECK(m == n && iar.nbyte_avail() == 0);
+        check(n, t, u);
+    }
+}
+
+void handler(const AmArg& arg) {
+    long n;
+    Tensor<double> t, u;
+    arg & n & t & u;
+    check(n, t, u);
+    ++nreceived;
+}
+
+/// Sends tensors of various sizes to every process, checking that all arrive
+void send_all(World& world) {
+    const Tensor<double> small = make_small();
+    long nsent = 0;
+    for (long n : sizes) {
+        for (ProcessID p=0; p<world.size(); ++p) {
+            Tensor<double> t = make(n);
+            world.am.send(p, handler, new_am_arg_bulk(n, t, small));
+            // The sender may drop its reference at once
+            t = Tensor<double>();
+            ++nsent;
+        }
+    }
+    world.gop.fence();
+    long nrecv = nreceived;
+    nreceived = 0;
+    world.gop.sum(nsent);
+    world.gop.sum(nrecv);
+    MADNESS_CHECK(nrecv == nsent);
+}
+
+/// Inserts tensors into a container from every process, so most travel in WorldObject messages
+void test_container(World& world) {
+    WorldContainer<long, Tensor<double> > dc(world);
+    const long nkey = 8*world.size();
+    for (long i=0; i<nkey; ++i) {
+        const long key = world.rank()*nkey + i;
+        dc.replace(key, copy(make(sizes[key%8])));
+    }
+    world.gop.fence();
+
+    long nlocal = 0;
+    for (auto it=dc.begin(); it!=dc.end(); ++it) {
+        check(sizes[it->first%8], it->second, make_small());
+        ++nlocal;
+    }
+    world.gop.sum(nlocal);
+    MADNESS_CHECK(nlocal == nkey*world.size());
+}
+
+int main(int argc, char** argv) {
+    initialize(argc, argv);
+    {
+        World world(SafeMPI::COMM_WORLD);
+        test_archive();
+
+        if (world.rank() == 0) print("tensors in buffers OK");
+
+        // Active messages need more than one process
+        if (world.size() > 1) {
+            const std::size_t threshold = RMI::bulk_threshold();
+
+            // Tensors of at least 4 KB travel beside the message
+            RMI::set_bulk_threshold(4096);
+            const RMIStats before = RMI::get_stats();
+            send_all(world);
+            test_container(world);
+            const uint64_t nbulk = RMI::get_stats().nbulk_sent - before.nbulk_sent;
+            MADNESS_CHECK(nbulk >= uint64_t(4*world.size()));
+
+            // All tensors copied into the message
+            RMI::set_bulk_threshold(0);
+            send_all(world);
+            MADNESS_CHECK(RMI::get_stats().nbulk_sent - before.nbulk_sent == nbulk);
+
+            RMI::set_bulk_threshold(threshold);
+            world.gop.fence();
+            if (world.rank() == 0) print("tensors in active messages OK");
+        }
+    }
+    finalize();
+    return 0;
+}
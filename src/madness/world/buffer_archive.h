@@ -42,6 +42,7 @@
 #include <madness/world/archive.h>
 #include <madness/world/print.h>
 #include <cstring>
+#include <memory>
 
 namespace madness {
     namespace archive {
@@ -56,24 +57,104 @@ namespace madness {
         /// \throw madness::MadnessException in case of buffer overflow.
         ///
         /// The default constructor can also be used to count stuff.
+        ///
+        /// If constructed with a \c growT function, a store that would
+        /// overflow the buffer instead asks that function for a larger
+        /// one, so that data of unknown size can be serialized in one
+        /// pass without first counting it.
+        ///
+        /// If given a \c bulkT function (see \c set_bulk), large contiguous
+        /// blocks (e.g., the data of a \c Tensor) may be handed to it to
+        /// travel beside the buffer rather than being copied into it, in
+        /// which case the buffer holds only the id that the function
+        /// returns.  Such a buffer must be read by a \c BufferInputArchive
+        /// with a matching \c fetchT function.
         class BufferOutputArchive : public BaseOutputArchive {
+        public:
+            /// Replaces a full buffer by a larger one
+
+            /// Called with the owner given to the constructor, the no. of
+            /// bytes used so far (which must be kept) and the no. needed.
+            /// Returns the new buffer and sets \c nbyte to its size.
+            typedef unsigned char* (*growT)(void* owner, std::size_t used, std::size_t need, std::size_t& nbyte);
+
+            /// Takes a block that travels beside the buffer
+
+            /// Called with the owner given to the constructor, the block
+            /// and an object that keeps the block unchanged and alive for
+            /// as long as it is held.  Returns the id of the block.
+            typedef unsigned long (*bulkT)(void* owner, const void* p, std::size_t nbyte, std::shared_ptr<const void> keeper);
+
         private:
-            unsigned char * const ptr; ///< The memory buffer.
-            const std::size_t nbyte; ///< Buffer size.
+            mutable unsigned char* ptr; ///< The memory buffer.
+            mutable std::size_t nbyte; ///< Buffer size.
             mutable std::size_t i; /// Current output location.
             bool countonly; ///< If true just count, don't copy.
+            growT grow; ///< Enlarges the buffer on overflow, if not null
+            void* owner; ///< Passed to grow and bulk
+            bulkT bulk; ///< Takes blocks of at least bulk_min bytes, if not null
+            std::size_t bulk_min; ///< Smallest block given to bulk
+
+            /// Makes room for m more bytes by growing the buffer, returning false if that is not possible
+            bool overflow(std::size_t m) const {
+                if (grow) ptr = grow(owner, i, i+m, nbyte);
+                if (i+m > nbyte) {
+                    madness::print("BufferOutputArchive:ptr,nbyte,i,m,i+m:",(void *)ptr,nbyte,i,m,i+m);
+                    MADNESS_ASSERT(i+m<=nbyte);
+                    return false;
+                }
+                return true;
+            }
 
         public:
             /// Default constructor; the buffer will only count data.
             BufferOutputArchive()
-                    : ptr(nullptr), nbyte(0), i(0), countonly(true) {}
+                    : ptr(nullptr), nbyte(0), i(0), countonly(true), grow(nullptr), owner(nullptr)
+                    , bulk(nullptr), bulk_min(0) {}
 
             /// Constructor that assigns a buffer.
 
             /// \param[in] ptr Pointer to the buffer.
             /// \param[in] nbyte Size of the buffer.
             BufferOutputArchive(void* ptr, std::size_t nbyte)
-                    : ptr((unsigned char *) ptr), nbyte(nbyte), i(0), countonly(false) {}
+                    : ptr((unsigned char *) ptr), nbyte(nbyte), i(0), countonly(false), grow(nullptr), owner(nullptr)
+                    , bulk(nullptr), bulk_min(0) {}
+
+            /// Constructor that assigns a buffer that grows when full.
+
+            /// \param[in] ptr Pointer to the buffer.
+            /// \param[in] nbyte Size of the buffer.
+            /// \param[in] grow Function called to replace the buffer when it is full.
+            /// \param[in] owner Passed to \c grow.
+            BufferOutputArchive(void* ptr, std::size_t nbyte, growT grow, void* owner)
+                    : ptr((unsigned char *) ptr), nbyte(nbyte), i(0), countonly(false), grow(grow), owner(owner)
+                    , bulk(nullptr), bulk_min(0) {}
+
+            /// Sends blocks of at least \c nmin bytes beside the buffer.
+
+            /// \param[in] f Function given the blocks, with the owner given to the constructor.
+            /// \param[in] nmin Size in bytes of the smallest block given to \c f.
+            void set_bulk(bulkT f, std::size_t nmin) {
+                MADNESS_ASSERT(!countonly && nmin > 0);
+                bulk = f;
+                bulk_min = nmin;
+            }
+
+            /// True if blocks may travel beside the buffer, which changes how they are stored.
+            bool has_bulk() const { return bulk; }
+
+            /// True if a block of \c n bytes should travel beside the buffer.
+            bool is_bulk(std::size_t n) const { return bulk && n >= bulk_min; }
+
+            /// Hands a block to the bulk function, returning the id to store in its place.
+
+            /// \param[in] p The block, which must not change while \c keeper is held.
+            /// \param[in] n Size of the block in bytes.
+            /// \param[in] keeper Keeps the block alive until it has been sent.
+            unsigned long store_bulk(const void* p, std::size_t n, std::shared_ptr<const void> keeper) const {
+                MADNESS_ASSERT(bulk);
+                return bulk(owner, p, n, std::move(keeper));
+            }
 
             /// Stores (counts) data into the memory buffer.
 
@@ -90,11 +171,7 @@ namespace madness {
                 if (countonly) {
                     i += m;
                 }
-                else if (i+m > nbyte) {
-                    madness::print("BufferOutputArchive:ptr,nbyte,i,n,m,i+m:",(void *)ptr,nbyte,i,n,m,i+m);
-                    MADNESS_ASSERT(i+m<=nbyte);
-                }
-                else {
+                else if (i+m <= nbyte || overflow(m)) {
 MADNESS_PRAGMA_GCC(diagnostic push)
 MADNESS_PRAGMA_GCC(diagnostic ignored "-Wmaybe-uninitialized")
 		  memcpy(ptr+i, t, m);
@@ -132,10 +209,19 @@ MADNESS_PRAGMA_GCC(diagnostic pop)
         ///
         /// \throw madness::MadnessException in case of buffer overrun.
         class BufferInputArchive : public BaseInputArchive {
+        public:
+            /// Receives a block that travelled beside the buffer
+
+            /// Called with the owner given to the constructor, the id
+            /// of the block and the memory into which to receive it.
+            typedef void (*fetchT)(const void* owner, unsigned long id, void* p, std::size_t nbyte);
+
         private:
             const unsigned char* const ptr; ///< The memory buffer.
             const std::size_t nbyte; ///< Buffer size.
             mutable std::size_t i; ///< Current input location.
+            fetchT fetch; ///< Receives blocks stored beside the buffer, if not null
+            const void* owner; ///< Passed to fetch
 
         public:
             /// Constructor that assigns a buffer.
@@ -143,7 +229,25 @@ MADNESS_PRAGMA_GCC(diagnostic pop)
             /// \param[in] ptr Pointer to the buffer.
             /// \param[in] nbyte Size of the buffer.
             BufferInputArchive(const void* ptr, std::size_t nbyte)
-                    : ptr((const unsigned char *) ptr), nbyte(nbyte), i(0) {};
+                    : ptr((const unsigned char *) ptr), nbyte(nbyte), i(0), fetch(nullptr), owner(nullptr) {};
+
+            /// Constructor that assigns a buffer written with blocks beside it.
+
+            /// \param[in] ptr Pointer to the buffer.
+            /// \param[in] nbyte Size of the buffer.
+            /// \param[in] fetch Function called to receive the blocks.
+            /// \param[in] owner Passed to \c fetch.
+            BufferInputArchive(const void* ptr, std::size_t nbyte, fetchT fetch, const void* owner)
+                    : ptr((const unsigned char *) ptr), nbyte(nbyte), i(0), fetch(fetch), owner(owner) {};
+
+            /// True if the buffer was written with blocks beside it (see \c BufferOutputArchive::has_bulk).
+            bool has_bulk() const { return fetch; }
+
+            /// Receives the block with the given id into \c p.
+            void load_bulk(unsigned long id, void* p, std::size_t n) const {
+                MADNESS_ASSERT(fetch);
+                fetch(owner, id, p, n);
+            }
 
             /// Reads data from the memory buffer.
 
@@ -247,6 +247,34 @@ namespace madness {
           do_callbacks(cb);
         }
 
+        /// \brief Registers the final callback unless `ndepend==0`, in which case the
+        ///    caller takes over its duty.
+
+        /// Same as \c register_final_callback() except that if there are no
+        /// unsatisfied dependencies \c callback is not invoked; the object is
+        /// made invalid and true is returned, so that the caller can do the
+        /// work of \c callback itself (e.g. submit a batch of ready tasks at once).
+        /// \param[in] callback The callback to use.
+        /// \return True if the caller must do the work of \c callback.
+        bool register_or_claim_final_callback(CallbackInterface* callback) {
+          callbackT cb;
+          bool claimed = false;
+          {
+            ScopedMutex<Spinlock> obolus(this);
+            MADNESS_ASSERT(ndepend >= 0);  // ensure we are valid
+            MADNESS_ASSERT(final_callback == nullptr);
+            final_callback = callback;
+            if (probe()) {
+              cb = std::move(const_cast<callbackT&>(callbacks));
+              // make object invalid
+              ndepend = -1;
+              claimed = true;
+            }
+          }
+          do_callbacks(cb);
+          return claimed;
+        }
+
         /// Increment the number of dependencies.
         void inc() {
             ScopedMutex<Spinlock> obolus(this);
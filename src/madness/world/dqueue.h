@@ -84,6 +84,7 @@ namespace madness {
         volatile T* volatile buf;        ///< Actual buffer
         volatile int _front;  ///< Index of element at front of buffer
         volatile int _back;    ///< Index of element at back of buffer
+        const bool use_prebuf; ///< If false never use the thread-local prebuffer
         DQStats stats;
 
 #ifdef MADNESS_DQ_USE_PREBUF
@@ -134,6 +135,12 @@ namespace madness {
         }
 
         void push_back_with_lock(const T& value) {
+            append_with_lock(value);
+            signal();
+        }
+
+        /// Like push_back_with_lock() but does not signal waiting threads
+        void append_with_lock(const T& value) {
             size_t nn = n;
             size_t ss = sz;
             if (nn == ss) {
@@ -153,8 +160,6 @@ namespace madness {
 #ifdef MADNESS_DQ_STATS
             ++(stats.npush_back);
 #endif
-
-            signal();
         }
 
         void push_front_with_lock(const T& value) {
@@ -187,6 +192,7 @@ namespace madness {
 
 	void flush_prebuf() {
 #ifdef MADNESS_DQ_USE_PREBUF
+	  if (!use_prebuf) return;
 	  if (ninprebuf) {
 	    for (size_t i=0; i<ninprebuf; i++) push_back_with_lock(prebuf[i]);
 	    ninprebuf = 0;
@@ -206,12 +212,16 @@ namespace madness {
 #endif
         }
 
-        DQueue(size_t hint=200000) // was 32768
+        /// The prebuffer is shared by all queues of the same type used
+        /// by a thread (it must be a singleton), so any additional queues
+        /// must be constructed with \c prebuf=false.
+        DQueue(size_t hint=200000, bool prebuf=true) // was 32768
                 : n(0)
                 , sz(hint>2 ? hint : 2)
                 , buf(new T[sz])
                 , _front(sz/2)
-	        , _back(_front-1) {}
+	        , _back(_front-1)
+	        , use_prebuf(prebuf) {}
 
         virtual ~DQueue() {
             delete [] buf;
@@ -225,6 +235,12 @@ namespace madness {
         /// Insert element at back of queue (default is just one copy)
         void push_back(const T& value, int ncopy=1);
 
+        /// Insert \c nvalue elements at back of queue, in order
+
+        /// The lock is taken once for the whole range and at most one
+        /// waiting thread per element is woken afterwards.
+        void push_back(const T* values, size_t nvalue);
+
         template <typename opT>
         void scan(opT& op) {
             madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
@@ -339,7 +355,7 @@ namespace madness {
     template <typename T>
     void DQueue<T>::lock_and_flush_prebuf() {
 #ifdef MADNESS_DQ_USE_PREBUF
-        if (ninprebuf+ninprebufhi) {
+        if (use_prebuf && ninprebuf+ninprebufhi) {
              madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
              flush_prebuf();
         }
@@ -349,7 +365,7 @@ namespace madness {
     template <typename T>
     void DQueue<T>::push_front(const T& value) {
 #ifdef MADNESS_DQ_USE_PREBUF
-        if (is_madness_thread() && ninprebufhi < NPREBUF) {
+        if (use_prebuf && is_madness_thread() && ninprebufhi < NPREBUF) {
              prebufhi[ninprebufhi++] = value;
              return;
         }
@@ -363,7 +379,7 @@ namespace madness {
     template <typename T>
     void DQueue<T>::push_back(const T& value, int ncopy) {
 #ifdef MADNESS_DQ_USE_PREBUF
-        if (is_madness_thread() && ncopy==1 && ninprebuf < NPREBUF) {
+        if (use_prebuf && is_madness_thread() && ncopy==1 && ninprebuf < NPREBUF) {
              prebuf[ninprebuf++] = value;
              return;
         }
@@ -379,9 +395,28 @@ namespace madness {
         }
     }
 
+    template <typename T>
+    void DQueue<T>::push_back(const T* values, size_t nvalue) {
+#ifdef MADNESS_DQ_USE_PREBUF
+        if (use_prebuf && is_madness_thread() && ninprebuf+nvalue <= NPREBUF) {
+             for (size_t i=0; i<nvalue; ++i) prebuf[ninprebuf++] = values[i];
+             return;
+        }
+#endif
+        {
+             madness::ScopedMutex<CONDITION_VARIABLE_TYPE> obolus(this);
+             flush_prebuf();
+             for (size_t i=0; i<nvalue; ++i)
+                 append_with_lock(values[i]);
+             for (size_t i=0; i<nvalue; ++i)
+                 signal();
+        }
+    }
+
     template <typename T>
     bool DQueue<T>::empty() const {
 #ifdef MADNESS_DQ_USE_PREBUF
+      if (!use_prebuf) return (n==0);
       return (ninprebuf+ninprebufhi+n)==0; // this is just from the perspective of this thread!!!!!
 #else
       return (n==0);
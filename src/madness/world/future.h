@@ -47,6 +47,7 @@
 #include <madness/world/stack.h>
 #include <madness/world/worldref.h>
 #include <madness/world/world.h>
+#include <madness/world/pool_alloc.h>
 
 /// \addtogroup futures
 /// @{
@@ -171,6 +172,8 @@ namespace madness {
 
             as.reset();
             cb.reset();
+
+            ThreadPool::notify_waiters();
         }
 
         /// Pass by value with implied copy to manage lifetime of \c f.
@@ -383,7 +386,7 @@ namespace madness {
 
         /// Makes an unassigned future.
         Future() :
-            f(new FutureImpl<T>()), value(nullptr)
+            f(std::allocate_shared<FutureImpl<T> >(PoolAllocator<FutureImpl<T> >())), value(nullptr)
         {
         }
 
@@ -403,7 +406,7 @@ namespace madness {
         explicit Future(const remote_refT& remote_ref) :
                 f(remote_ref.is_local() ?
                         remote_ref.get_shared() :
-                        std::make_shared<FutureImpl<T> >(remote_ref)),
+                        std::allocate_shared<FutureImpl<T> >(PoolAllocator<FutureImpl<T> >(), remote_ref)),
                 //                        std::shared_ptr<FutureImpl<T> >(new FutureImpl<T>(remote_ref))),
                 value(nullptr)
         {
@@ -430,7 +433,7 @@ namespace madness {
                 nullptr)
         {
             if(other.is_default_initialized())
-                f.reset(new FutureImpl<T>()); // Other was default constructed so make a new f
+                f = std::allocate_shared<FutureImpl<T> >(PoolAllocator<FutureImpl<T> >()); // Other was default constructed so make a new f
         }
 
         /// Destructor.
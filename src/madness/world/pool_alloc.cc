@@ -0,0 +1,298 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+/// \file pool_alloc.cc
+/// \brief Implements the thread-caching size-class allocator
+
+#include <madness/world/pool_alloc.h>
+#include <madness/world/worldmutex.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace madness {
+    namespace detail {
+
+        namespace {
+
+            struct Block {
+                Block* next;
+            };
+
+            /// Blocks of one class shared by all threads
+            struct CentralList : public Spinlock {
+                Block* head;
+                CentralList() : Spinlock(), head(nullptr) {}
+            };
+
+            std::atomic<unsigned long> stat_nalloc{0}, stat_nfree{0}, stat_nlarge{0},
+                stat_nrefill{0}, stat_nspill{0}, stat_slab_bytes{0};
+
+            /// The central lists ... never destroyed, since blocks may be freed during static destruction
+            CentralList* central() {
+                static CentralList* lists = new CentralList[PoolAlloc::NCLASS];
+                return lists;
+            }
+
+            /// No. of blocks moved at once between a thread and the central list
+            constexpr int batch_size(int c) {
+                const int n = int(32768/PoolAlloc::class_size(c));
+                return n < 2 ? 2 : (n > 64 ? 64 : n);
+            }
+
+            struct BatchTable {
+                int n[PoolAlloc::NCLASS];
+                constexpr BatchTable() : n() {
+                    for (int c=0; c<PoolAlloc::NCLASS; ++c) n[c] = batch_size(c);
+                }
+            };
+
+            constexpr BatchTable batch_table;
+
+            /// Carves a new slab into blocks of class c, returning a list of batch_size(c) of them
+
+            /// The remainder of the slab goes to the central list.
+            Block* new_slab(int c) {
+                const std::size_t size = PoolAlloc::class_size(c);
+                const int nbatch = batch_table.n[c];
+                std::size_t nblock = 65536/size;
+                if (nblock < std::size_t(2*nbatch)) nblock = 2*nbatch;
+                char* slab = static_cast<char*>(::operator new(nblock*size));
+                stat_slab_bytes.fetch_add(nblock*size, std::memory_order_relaxed);
+
+                for (std::size_t i=0; i<nblock-1; ++i)
+                    reinterpret_cast<Block*>(slab + i*size)->next = reinterpret_cast<Block*>(slab + (i+1)*size);
+                reinterpret_cast<Block*>(slab + (nblock-1)*size)->next = nullptr;
+
+                Block* rest = reinterpret_cast<Block*>(slab + nbatch*size);
+                reinterpret_cast<Block*>(slab + (nbatch-1)*size)->next = nullptr;
+                Block* last = reinterpret_cast<Block*>(slab + (nblock-1)*size);
+
+                CentralList& cl = central()[c];
+                cl.lock();
+                last->next = cl.head;
+                cl.head = rest;
+                cl.unlock();
+
+                return reinterpret_cast<Block*>(slab);
+            }
+
+            /// Per-thread free lists
+
+            /// Trivial so that access to the thread-local instance needs no
+            /// initialization check; the lists are returned to the central
+            /// lists at thread exit by a CacheFlusher.
+            struct ThreadCache {
+                Block* head[PoolAlloc::NCLASS];
+                int n[PoolAlloc::NCLASS];
+                unsigned long nalloc, nfree;
+                bool registered;  ///< CacheFlusher constructed for this thread
+                bool destroyed;   ///< Thread is exiting ... use the central lists directly
+
+                void register_flusher();
+
+                /// Reports the counts to the global statistics
+                void report() {
+                    stat_nalloc.fetch_add(nalloc, std::memory_order_relaxed);
+                    stat_nfree.fetch_add(nfree, std::memory_order_relaxed);
+                    nalloc = nfree = 0;
+                }
+
+                /// Takes a batch from the central list, or a new slab if it is empty
+                void refill(int c) {
+                    if (!registered) register_flusher();
+                    const int nbatch = batch_table.n[c];
+                    CentralList& cl = central()[c];
+                    Block* first = nullptr;
+                    int got = 0;
+                    cl.lock();
+                    if (cl.head) {
+                        first = cl.head;
+                        Block* last = first;
+                        got = 1;
+                        while (got < nbatch && last->next) {
+                            last = last->next;
+                            ++got;
+                        }
+                        cl.head = last->next;
+                        last->next = nullptr;
+                    }
+                    cl.unlock();
+
+                    if (!first) {
+                        first = new_slab(c);
+                        got = nbatch;
+                    }
+                    head[c] = first;
+                    n[c] = got;
+                    stat_nrefill.fetch_add(1, std::memory_order_relaxed);
+                    report();
+                }
+
+                /// Moves nmove blocks of class c to the central list
+                void spill(int c, int nmove) {
+                    Block* first = head[c];
+                    Block* last = first;
+                    for (int i=1; i<nmove; ++i) last = last->next;
+                    head[c] = last->next;
+                    n[c] -= nmove;
+
+                    CentralList& cl = central()[c];
+                    cl.lock();
+                    last->next = cl.head;
+                    cl.head = first;
+                    cl.unlock();
+                    stat_nspill.fetch_add(1, std::memory_order_relaxed);
+                    report();
+                }
+            };
+
+            thread_local ThreadCache cache;
+
+            /// Returns the free lists of this thread to the central lists when it exits
+            struct CacheFlusher {
+                void touch() {}
+                ~CacheFlusher() {
+                    for (int c=0; c<PoolAlloc::NCLASS; ++c)
+                        if (cache.n[c]) cache.spill(c, cache.n[c]);
+                    cache.report();
+                    cache.destroyed = true;
+                }
+            };
+
+            thread_local CacheFlusher flusher;
+
+            void ThreadCache::register_flusher() {
+                registered = true;
+                flusher.touch();
+            }
+
+            /// Allocation after this thread's cache was flushed (e.g., in static destructors)
+            void* central_allocate(int c) {
+                CentralList& cl = central()[c];
+                cl.lock();
+                Block* b = cl.head;
+                if (b) cl.head = b->next;
+                cl.unlock();
+                if (!b) {
+                    b = new_slab(c);
+                    Block* rest = b->next;
+                    if (rest) {
+                        Block* last = rest;
+                        while (last->next) last = last->next;
+                        cl.lock();
+                        last->next = cl.head;
+                        cl.head = rest;
+                        cl.unlock();
+                    }
+                }
+                stat_nalloc.fetch_add(1, std::memory_order_relaxed);
+                return b;
+            }
+
+            /// Free after this thread's cache was flushed
+            void central_deallocate(void* p, int c) {
+                Block* b = static_cast<Block*>(p);
+                CentralList& cl = central()[c];
+                cl.lock();
+                b->next = cl.head;
+                cl.head = b;
+                cl.unlock();
+                stat_nfree.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /// 0 until first use, then 1 if the pool is in use and 2 if not
+            std::atomic<int> pool_state{0};
+
+        } // namespace
+
+        bool PoolAlloc::enabled() {
+            int state = pool_state.load(std::memory_order_relaxed);
+            if (state == 0) {
+                const char* s = std::getenv("MAD_POOL_ALLOC");
+                state = (s && std::strcmp(s, "0") == 0) ? 2 : 1;
+                pool_state.store(state, std::memory_order_relaxed);
+            }
+            return state == 1;
+        }
+
+        void* PoolAlloc::allocate(std::size_t n) {
+            if (n > MAXSIZE || !enabled()) {
+                stat_nlarge.fetch_add(1, std::memory_order_relaxed);
+                return ::operator new(n);
+            }
+            const int c = size_class(n);
+            ThreadCache& tc = cache;
+            if (tc.destroyed) return central_allocate(c);
+
+            if (!tc.head[c]) tc.refill(c);
+            Block* b = tc.head[c];
+            tc.head[c] = b->next;
+            --tc.n[c];
+            ++tc.nalloc;
+            return b;
+        }
+
+        void PoolAlloc::deallocate(void* p, std::size_t n) {
+            if (!p) return;
+            if (n > MAXSIZE || !enabled()) {
+                ::operator delete(p);
+                return;
+            }
+            const int c = size_class(n);
+            ThreadCache& tc = cache;
+            if (tc.destroyed) {
+                central_deallocate(p, c);
+                return;
+            }
+            if (!tc.registered) tc.register_flusher();
+
+            Block* b = static_cast<Block*>(p);
+            b->next = tc.head[c];
+            tc.head[c] = b;
+            ++tc.nfree;
+            const int nbatch = batch_table.n[c];
+            if (++tc.n[c] > 2*nbatch) tc.spill(c, nbatch);
+        }
+
+        PoolAllocStats PoolAlloc::stats() {
+            PoolAllocStats s;
+            s.nalloc = stat_nalloc.load();
+            s.nfree = stat_nfree.load();
+            s.nlarge = stat_nlarge.load();
+            s.nrefill = stat_nrefill.load();
+            s.nspill = stat_nspill.load();
+            s.slab_bytes = stat_slab_bytes.load();
+            return s;
+        }
+
+    } // namespace detail
+} // namespace madness
@@ -0,0 +1,186 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_POOL_ALLOC_H__INCLUDED
+#define MADNESS_WORLD_POOL_ALLOC_H__INCLUDED
+
+/// \file pool_alloc.h
+/// \brief Thread-caching size-class allocator for short-lived runtime objects
+
+// Active message buffers, tasks and future implementations are
+// allocated and freed millions of times per second, usually by
+// different threads (e.g., the communication thread allocates the
+// buffer of an incoming task that a pool thread frees).  The pool
+// rounds each request up to one of a set of size classes (16 byte
+// steps up to 64 bytes, then four classes per power of two up to
+// 64 KB).  Each thread keeps a free list per class and allocates and
+// frees without locking or atomics.  A thread whose list grows too
+// long moves a batch of blocks to a central list for the class, from
+// which a thread with an empty list takes a batch, so memory freed by
+// one thread is reused by the others.  Memory for the classes is
+// taken from the heap in slabs that are never returned.  Larger
+// requests go straight to the heap.
+//
+// The pool is used unless the environment variable MAD_POOL_ALLOC is
+// set to 0 when it is first used.
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace madness {
+
+    /// Statistics of the pool allocator summed over all threads
+
+    /// Threads report their counts when they exchange a batch with the
+    /// central lists and when they exit, so the counts lag by up to a
+    /// batch per thread.
+    struct PoolAllocStats {
+        unsigned long nalloc;      ///< Blocks handed out from the size classes
+        unsigned long nfree;       ///< Blocks returned to the size classes
+        unsigned long nlarge;      ///< Requests too large for a size class, passed to the heap
+        unsigned long nrefill;     ///< Batches taken from the central lists
+        unsigned long nspill;      ///< Batches moved to the central lists
+        unsigned long slab_bytes;  ///< Bytes taken from the heap for the size classes
+    };
+
+    namespace detail {
+
+        /// The size classes and the entry points of the pool
+        class PoolAlloc {
+        public:
+            static const std::size_t MAXSIZE = 65536; ///< Largest request served by a size class
+            static const int NCLASS = 44;             ///< No. of size classes
+
+            /// Returns the size class for a request of n bytes (n <= MAXSIZE)
+            static constexpr int size_class(std::size_t n) {
+                if (n <= 64) return n ? int((n+15)/16 - 1) : 0;
+                const std::size_t m = n - 1;
+                const int k = std::numeric_limits<unsigned long>::digits - 1 - __builtin_clzl(m);
+                return 4 + (k-6)*4 + int((m >> (k-2)) & 3);
+            }
+
+            /// Returns the size of the blocks of class c
+            static constexpr std::size_t class_size(int c) {
+                if (c < 4) return 16*(c+1);
+                const int k = (c-4)/4 + 6;
+                return std::size_t(5 + (c-4)%4) << (k-2);
+            }
+
+            /// True if the pool is in use (fixed on first call)
+            static bool enabled();
+
+            /// Allocates n bytes aligned to 16 bytes
+            static void* allocate(std::size_t n);
+
+            /// Frees p that was allocated with the same n
+            static void deallocate(void* p, std::size_t n);
+
+            /// Returns the statistics
+            static PoolAllocStats stats();
+        };
+
+    } // namespace detail
+
+    /// Allocates nbyte bytes from the pool ... free with pool_deallocate(p,nbyte)
+    inline void* pool_allocate(std::size_t nbyte) {
+        return detail::PoolAlloc::allocate(nbyte);
+    }
+
+    /// Frees memory allocated with pool_allocate, which must be given the same size
+    inline void pool_deallocate(void* p, std::size_t nbyte) {
+        detail::PoolAlloc::deallocate(p, nbyte);
+    }
+
+    /// Returns the statistics of the pool allocator
+    inline PoolAllocStats pool_alloc_stats() {
+        return detail::PoolAlloc::stats();
+    }
+
+    /// Standard allocator drawing from the pool
+
+    /// Used with \c std::allocate_shared so that an object and the
+    /// control block of its \c shared_ptr are one pooled allocation.
+    template <typename T>
+    class PoolAllocator {
+    public:
+        typedef T value_type;
+
+        PoolAllocator() = default;
+        template <typename U> PoolAllocator(const PoolAllocator<U>&) {}
+
+        T* allocate(std::size_t n) {
+            if (alignof(T) > 16)
+                return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(alignof(T))));
+            return static_cast<T*>(pool_allocate(n*sizeof(T)));
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            if (alignof(T) > 16)
+                ::operator delete(p, std::align_val_t(alignof(T)));
+            else
+                pool_deallocate(p, n*sizeof(T));
+        }
+
+        template <typename U> bool operator==(const PoolAllocator<U>&) const { return true; }
+        template <typename U> bool operator!=(const PoolAllocator<U>&) const { return false; }
+    };
+
+    /// Base class that makes \c new and \c delete of derived classes use the pool
+
+    /// Relies on sized deallocation, so a class deleted through a
+    /// pointer to its base must have a virtual destructor.
+    class PoolAllocated {
+    public:
+        static void* operator new(std::size_t size) {
+            return pool_allocate(size);
+        }
+
+        static void operator delete(void* p, std::size_t size) {
+            pool_deallocate(p, size);
+        }
+
+        static void* operator new(std::size_t size, std::align_val_t al) {
+            return ::operator new(size, al);
+        }
+
+        static void operator delete(void* p, std::size_t, std::align_val_t al) {
+            ::operator delete(p, al);
+        }
+
+        /// Placement new is unaffected
+        static void* operator new(std::size_t, void* p) { return p; }
+        static void operator delete(void*, void*) {}
+    };
+
+} // namespace madness
+
+#endif // MADNESS_WORLD_POOL_ALLOC_H__INCLUDED
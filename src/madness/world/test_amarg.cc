@@ -0,0 +1,166 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/MADworld.h>
+#include <madness/world/worldam.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// \file test_amarg.cc
+/// \brief Tests and times making active message arguments with new_am_arg
+
+// Checks that messages made in one pass (growing the buffer as needed)
+// hold the same bytes as those made by counting first, then times both
+// for argument lists like those sent by MRA operators: an object id,
+// a member function pointer, a tree key and a block of coefficients
+// (k^3 doubles for k = 6, 8 and 10, as a 3-d function would send).
+
+using namespace madness;
+
+bool smalltest = false;
+
+/// Stands in for Key<3>
+struct KeyLike {
+    int n;
+    long l[3];
+    unsigned long hashval;
+};
+
+struct Handler {
+    void accumulate(const KeyLike&, const std::vector<double>&) {}
+};
+
+typedef void (Handler::*memfunT)(const KeyLike&, const std::vector<double>&);
+
+/// The previous implementation of new_am_arg, which counts the bytes first
+template <typename... argT>
+AmArg* new_am_arg_counted(const argT&... args) {
+    archive::BufferOutputArchive count;
+    serialize_am_args(count, args...);
+    AmArg* am_args = alloc_am_arg(count.size());
+    archive::BufferOutputArchive ar(am_args->buf(), count.size());
+    serialize_am_args(ar, args...);
+    return am_args;
+}
+
+void check(bool ok, const char* msg) {
+    if (!ok) {
+        std::cout << "failed: " << msg << std::endl;
+        std::exit(1);
+    }
+}
+
+bool same(const AmArg* a, const AmArg* b) {
+    return a->size() == b->size() && std::memcmp(a->buf(), b->buf(), a->size()) == 0;
+}
+
+void test_correctness() {
+    const uniqueidT id;
+    const memfunT fn = &Handler::accumulate;
+    const KeyLike key = {3, {1, 2, 3}, 12345};
+
+    // Compile-time size
+    AmArg* a = new_am_arg(1ul, key, 2.0, 7);
+    AmArg* b = new_am_arg_counted(1ul, key, 2.0, 7);
+    check(same(a, b), "trivially serializable arguments");
+    free_am_arg(a);
+    free_am_arg(b);
+
+    // Sizes that vary between calls so the buffer must grow, or shrink
+    for (std::size_t n : {10, 1000, 100000, 3, 50000, 0}) {
+        std::vector<double> v(n);
+        for (std::size_t i=0; i<n; ++i) v[i] = double(i);
+        std::string s(n%97, 'x');
+        a = new_am_arg(id, fn, key, v, s);
+        b = new_am_arg_counted(id, fn, key, v, s);
+        check(same(a, b), "variable-size arguments");
+
+        std::vector<double> w;
+        std::string t;
+        KeyLike k;
+        uniqueidT i;
+        memfunT f;
+        *a & i & f & k & w & t;
+        check(w == v && t == s && k.hashval == key.hashval && f == fn, "round trip");
+        free_am_arg(a);
+        free_am_arg(b);
+    }
+    std::cout << "new_am_arg OK" << std::endl;
+}
+
+template <typename makeT>
+double time_make(makeT make) {
+    const int nrep = smalltest ? 20000 : 200000;
+    double start = wall_time();
+    for (int i=0; i<nrep; ++i) free_am_arg(make());
+    return 1e9*(wall_time() - start)/nrep;
+}
+
+void bench() {
+    const uniqueidT id;
+    const memfunT fn = &Handler::accumulate;
+    const KeyLike key = {3, {1, 2, 3}, 12345};
+
+    std::cout << "\nns per message      counted    one pass\n";
+    printf("%-16s %10.1f %10.1f\n", "long,key,double",
+           time_make([&]() { return new_am_arg_counted(1ul, key, 1.0); }),
+           time_make([&]() { return new_am_arg(1ul, key, 1.0); }));
+    printf("%-16s %10.1f %10.1f\n", "id,fn,key",
+           time_make([&]() { return new_am_arg_counted(id, fn, key); }),
+           time_make([&]() { return new_am_arg(id, fn, key); }));
+    for (int k : {6, 8, 10}) {
+        std::vector<double> coeff(k*k*k, 1.0);
+        char name[32];
+        snprintf(name, sizeof(name), "id,fn,key,k=%d", k);
+        printf("%-16s %10.1f %10.1f\n", name,
+               time_make([&]() { return new_am_arg_counted(id, fn, key, coeff); }),
+               time_make([&]() { return new_am_arg(id, fn, key, coeff); }));
+    }
+}
+
+int main(int argc, char** argv) {
+    if (getenv("MAD_SMALL_TESTS")) smalltest=true;
+    for (int iarg=1; iarg<argc; iarg++) if (strcmp(argv[iarg],"--small")==0) smalltest=true;
+    std::cout << "small test : " << smalltest << std::endl;
+
+    initialize(argc, argv);
+    {
+        World world(SafeMPI::COMM_WORLD);
+        test_correctness();
+        bench();
+    }
+    finalize();
+
+    return 0;
+}
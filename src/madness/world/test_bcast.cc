@@ -0,0 +1,110 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/MADworld.h>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+
+/// \file test_bcast.cc
+/// \brief Checks and times WorldGopInterface::broadcast for message sizes from 1 KB to 1 GB
+
+// Each size is broadcast from the last process using the plain binary
+// tree, the pipelined tree and (with more than two processes) scatter
+// then allgather, and every process checks what it received.
+
+using namespace madness;
+
+enum Method {TREE, PIPELINED, SCATTER};
+
+double bcast(World& world, std::vector<unsigned char>& buf, std::size_t nbyte, Method method, int nrep) {
+    const ProcessID root = world.size() - 1;
+    const std::size_t segment = world.gop.set_broadcast_segment(method==TREE ? 0 : 65536);
+    const std::size_t scatter = world.gop.set_broadcast_scatter(method==SCATTER ? 1 : 0);
+
+    double used = 0.0;
+    for (int rep=0; rep<nrep; ++rep) {
+        for (std::size_t i=0; i<nbyte; ++i) {
+            buf[i] = (world.rank() == root) ? static_cast<unsigned char>((i*7 + rep) & 0xff) : 0;
+        }
+        world.gop.fence();
+        double start = wall_time();
+        world.gop.broadcast(buf.data(), nbyte, root);
+        used += wall_time() - start;
+
+        for (std::size_t i=0; i<nbyte; ++i) {
+            if (buf[i] != static_cast<unsigned char>((i*7 + rep) & 0xff)) {
+                print("broadcast of", nbyte, "bytes with method", int(method), "wrong at byte", i);
+                error("broadcast failed");
+            }
+        }
+    }
+
+    world.gop.set_broadcast_segment(segment);
+    world.gop.set_broadcast_scatter(scatter);
+    world.gop.max(used);
+    return used/nrep;
+}
+
+int main(int argc, char** argv) {
+    bool smalltest = false;
+    if (getenv("MAD_SMALL_TESTS")) smalltest=true;
+    for (int iarg=1; iarg<argc; iarg++) if (strcmp(argv[iarg],"--small")==0) smalltest=true;
+
+    World& world = initialize(argc, argv);
+    if (world.rank() == 0) std::cout << "small test : " << smalltest << std::endl;
+
+    if (world.size() == 1) {
+        if (world.rank() == 0) print("broadcast needs more than one process ... nothing to test");
+    }
+    else {
+        const std::size_t maxbyte = smalltest ? (std::size_t(1) << 24) : (std::size_t(1) << 30);
+        std::vector<unsigned char> buf(maxbyte);
+        if (world.rank() == 0) {
+            printf("%12s %12s %12s %12s   (GB/s)\n", "bytes", "tree", "pipelined", "scatter");
+        }
+        for (std::size_t nbyte=1024; nbyte<=maxbyte; nbyte*=4) {
+            const int nrep = (nbyte < (std::size_t(1) << 20)) ? 10 : 1;
+            const double ttree = bcast(world, buf, nbyte, TREE, nrep);
+            const double tpipe = bcast(world, buf, nbyte, PIPELINED, nrep);
+            const double tscat = (world.size() > 2) ? bcast(world, buf, nbyte, SCATTER, nrep) : 0.0;
+            if (world.rank() == 0) {
+                printf("%12zu %12.3f %12.3f %12.3f\n", nbyte, 1e-9*nbyte/ttree, 1e-9*nbyte/tpipe,
+                       (tscat > 0.0) ? 1e-9*nbyte/tscat : 0.0);
+            }
+        }
+        if (world.rank() == 0) print("test_bcast OK");
+    }
+
+    finalize();
+    return 0;
+}
@@ -30,7 +30,9 @@
 */
 
 #include <madness/world/MADworld.h>
+#include <algorithm>
 #include <string>
+#include <thread>
 
 using namespace madness;
 using namespace std;
@@ -66,6 +68,27 @@ int main(int argc, char** argv) {
 
     print(s.get(), ggg.get());
 
+    // With the adaptive policy a thread waiting on a future that is set
+    // late parks and is woken by the assignment
+    if (ThreadPool::size() > 0) {
+        threadpool_wait_policy(WaitPolicy::Adaptive, 1000000);
+        const AwaitStats before = ThreadPool::get_await_stats();
+        Future<string> slow;
+        std::thread setter([&slow] () { myusleep(50000); slow.set("slow"); });
+        MADNESS_CHECK(slow.get() == "slow");
+        setter.join();
+        world.taskq.add([] () { myusleep(10000); });
+        world.gop.fence();
+        const AwaitStats after = ThreadPool::get_await_stats();
+        print("parked", after.npark - before.npark, "woken", after.nwakeup - before.nwakeup,
+              "idle", after.idle_time - before.idle_time,
+              "mean wakeup latency", (after.wakeup_latency - before.wakeup_latency) /
+                  std::max(after.nwakeup - before.nwakeup, std::uint64_t(1)));
+        MADNESS_CHECK(after.npark > before.npark);
+        MADNESS_CHECK(after.nwakeup > before.nwakeup);
+        threadpool_wait_policy(WaitPolicy::Busy);
+    }
+
     madness::finalize();
     return 0;
 }
@@ -0,0 +1,307 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/world.h>
+#include <madness/world/thread.h>
+#include <madness/world/worldhash.h>
+#include <madness/world/worldhashmap.h>
+#include <madness/world/worldhashmap_open.h>
+#include <madness/world/range.h>
+#include <madness/world/timers.h>
+#include <madness/world/atomicint.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// \file test_hashbench.cc
+/// \brief Tests OpenHashMap and compares its throughput with ConcurrentHashMap
+
+// Checks OpenHashMap sequentially and with several threads inserting,
+// erasing and updating through accessors, then times insert, find,
+// accessor and erase for both hash maps.  By default the sizes are kept
+// small enough for the unit tests; run with --bench for timings with up
+// to 128 threads and 4M keys.
+
+using namespace madness;
+
+bool smalltest = true;
+
+typedef OpenHashMap<int,double> openT;
+typedef ConcurrentHashMap<int,double> chainT;
+
+madness::AtomicInt nready, ndone;
+volatile bool go = false;
+
+class Runner : public madness::ThreadBase {
+private:
+    std::function<void()> f;
+
+public:
+    Runner(const std::function<void()>& f) : ThreadBase(), f(f) {
+        start();
+    }
+
+    void run() {
+        nready++;
+        while (!go) sched_yield();
+        f();
+        ndone++;
+    }
+};
+
+/// Runs f(0), ..., f(nthread-1) in nthread threads and returns the wall time taken
+double run_threads(int nthread, const std::function<void(int)>& f) {
+    nready = 0;
+    ndone = 0;
+    go = false;
+    std::vector<std::unique_ptr<Runner> > threads;
+    for (int i=0; i<nthread; ++i) threads.emplace_back(new Runner([&f,i]() { f(i); }));
+    while (nready != nthread) sched_yield();
+    double start = wall_time();
+    go = true;
+    while (ndone != nthread) sched_yield();
+    double used = wall_time() - start;
+    go = false;
+    return used;
+}
+
+void check(bool ok, const char* msg) {
+    if (!ok) MADNESS_EXCEPTION(msg, 0);
+}
+
+template <typename mapT>
+void split(const Range<typename mapT::iterator>& range, std::size_t& count) {
+    typedef Range<typename mapT::iterator> rangeT;
+    if (range.size() <= range.get_chunksize()) {
+        for (typename rangeT::iterator it=range.begin();  it != range.end();  ++it) count++;
+    }
+    else {
+        rangeT left = range;
+        rangeT right(left,Split());
+        split<mapT>(left, count);
+        split<mapT>(right, count);
+    }
+}
+
+void test_sequential() {
+    typedef openT::datumT datumT;
+    openT a(16); // Small so that it must grow
+    const int n = 100000;
+
+    a[-1] = -99;
+    check(a[-1] == -99 && a.size() == 1, "operator[]");
+
+    for (int i=0; i<n; ++i) check(a.insert(datumT(i,i*99)).second, "first insert");
+    for (int i=0; i<n; ++i) {
+        std::pair<openT::iterator,bool> r = a.insert(datumT(i,0));
+        check(!r.second && r.first->first == i && r.first->second == i*99, "second insert");
+    }
+    check(a.size() == std::size_t(n+1), "size after insert");
+
+    const openT& ca = a;
+    for (int i=0; i<n; ++i) {
+        openT::const_iterator it = ca.find(i);
+        check(it != ca.end() && it->second == i*99, "find");
+    }
+    check(a.find(n) == a.end(), "find of absent key");
+
+    std::size_t count = 0;
+    for (openT::iterator it=a.begin(); it!=a.end(); ++it) {
+        count++;
+        check(it->second == 99*it->first, "iteration");
+    }
+    check(count == std::size_t(n+1), "count by iteration");
+
+    count = 0;
+    split<openT>(Range<openT::iterator>(a.begin(), a.end(), 37), count);
+    check(count == std::size_t(n+1), "count by range");
+
+    for (int i=0; i<n; i+=2) check(a.erase(i) == 1, "erase");
+    for (int i=0; i<n; i+=2) check(a.erase(i) == 0, "second erase");
+    check(a.size() == std::size_t(n/2+1), "size after erase");
+    for (int i=0; i<n; ++i) check((a.find(i) == a.end()) == (i%2 == 0), "find after erase");
+
+    openT::accessor acc;
+    check(a.insert(acc, 1) == false && acc->second == 99, "insert accessor");
+    acc->second = 1.0;
+    a.erase(acc);
+    check(a.find(1) == a.end(), "erase accessor");
+
+    openT::const_accessor cacc;
+    check(ca.find(cacc, 3) && cacc->second == 3*99, "find const_accessor");
+    a.erase(cacc);
+    check(a.find(3) == a.end(), "erase const_accessor");
+
+    // An iterator made before the table grows must not reach entries erased afterwards
+    {
+        openT c(16);
+        for (int i=0; i<100; ++i) c.insert(datumT(i,i));
+        openT::iterator it = c.begin();
+        for (int i=100; i<n; ++i) c.insert(datumT(i,i));
+        const int first = it->first;
+        for (int i=0; i<100; ++i) if (i != first) c.erase(i);
+        for (; it!=c.end(); ++it) check(it->first == first || it->first >= 100, "iteration over an old table");
+    }
+
+    openT b(a);
+    check(b.size() == a.size() && b.find(5)->second == 5*99, "copy");
+
+    a.clear();
+    check(a.size() == 0 && a.begin() == a.end(), "clear");
+    a[7] = 7.0;
+    check(a.size() == 1, "insert after clear");
+
+    std::cout << "OpenHashMap sequential tests OK\n";
+}
+
+/// Threads insert and erase random keys from a small range and check the final sum
+void test_threads_random(int nthread) {
+    typedef openT::datumT datumT;
+    openT a(64);
+    const int nkey = 500;
+    const int nop = smalltest ? 100000 : 2000000;
+    std::vector<double> sums(nthread, 0.0);
+
+    run_threads(nthread, [&](int id) {
+        unsigned int seed = id+1;
+        for (int i=0; i<nop; ++i) {
+            int key = rand_r(&seed) % nkey;
+            if (rand_r(&seed) & 1) {
+                if (a.insert(datumT(key,key)).second) sums[id] += key;
+            }
+            else {
+                if (a.erase(key)) sums[id] -= key;
+            }
+        }
+    });
+
+    double sum = 0.0, end_sum = 0.0;
+    for (int i=0; i<nthread; ++i) sum += sums[i];
+    std::size_t end_count = 0;
+    for (openT::iterator it=a.begin(); it!=a.end(); ++it) {
+        end_count++;
+        end_sum += it->second;
+    }
+    check(sum == end_sum && end_count == a.size(), "threaded insert/erase");
+}
+
+/// Threads increment one value through write accessors while others insert
+void test_threads_accessor(int nthread) {
+    typedef openT::datumT datumT;
+    openT a(16);
+    const int nop = smalltest ? 20000 : 200000;
+    a[-1] = 0.0;
+
+    run_threads(nthread, [&](int id) {
+        for (int i=0; i<nop; ++i) {
+            {
+                openT::accessor r;
+                if (!a.find(r, -1)) MADNESS_EXCEPTION("where is it?", 0);
+                r->second++;
+            }
+            a.insert(datumT(id*nop + i, 0.0)); // Forces the table to grow meanwhile
+        }
+    });
+
+    check(a[-1] == double(nthread)*nop, "threaded accessors");
+    check(a.size() == std::size_t(nthread)*nop + 1, "threaded size");
+}
+
+template <typename mapT>
+void bench(const char* name, int nthread, int nkey) {
+    typedef typename mapT::datumT datumT;
+    mapT a;
+    const int per = nkey/nthread;
+
+    double tinsert = run_threads(nthread, [&](int id) {
+        for (int i=0; i<per; ++i) a.insert(datumT(id*per + i, i));
+    });
+
+    double tfind = run_threads(nthread, [&](int id) {
+        unsigned int seed = id+1;
+        double sum = 0.0;
+        for (int i=0; i<per; ++i) sum += a.find(rand_r(&seed) % (per*nthread))->second;
+        if (sum < 0) std::cout << sum;
+    });
+
+    double taccess = run_threads(nthread, [&](int id) {
+        unsigned int seed = id+1;
+        for (int i=0; i<per; ++i) {
+            typename mapT::accessor r;
+            a.find(r, rand_r(&seed) % (per*nthread));
+            r->second += 1.0;
+        }
+    });
+
+    double terase = run_threads(nthread, [&](int id) {
+        for (int i=0; i<per; ++i) a.erase(id*per + i);
+    });
+
+    const double nop = 1e-6*per*nthread;
+    printf("%-12s %7d %10.2f %10.2f %10.2f %10.2f\n", name, nthread,
+           nop/tinsert, nop/tfind, nop/taccess, nop/terase);
+}
+
+int main(int argc, char** argv) {
+    madness::initialize(argc,argv);
+
+    for (int iarg=1; iarg<argc; iarg++) if (strcmp(argv[iarg],"--bench")==0) smalltest=false;
+    std::cout << "small test : " << smalltest << std::endl;
+
+    int status = 0;
+    try {
+        test_sequential();
+        for (int nthread=1; nthread<=(smalltest ? 4 : 16); nthread*=2) {
+            test_threads_random(nthread);
+            test_threads_accessor(nthread);
+        }
+        std::cout << "OpenHashMap threaded tests OK\n";
+
+        const int nkey = smalltest ? (1<<16) : (1<<22);
+        const int maxthread = smalltest ? 4 : 128;
+        printf("\n%-12s %7s %10s %10s %10s %10s   (Mops/s)\n", "map", "threads", "insert", "find", "accessor", "erase");
+        for (int nthread=1; nthread<=maxthread; nthread*=2) {
+            bench<chainT>("concurrent", nthread, nkey);
+            bench<openT>("open", nthread, nkey);
+        }
+    }
+    catch (const madness::MadnessException& e) {
+        std::cout << e << std::endl;
+        status = 1;
+    }
+
+    madness::finalize();
+    return status;
+}
@@ -0,0 +1,207 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/MADworld.h>
+#include <madness/world/pool_alloc.h>
+#include <madness/world/worldmem.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/// \file test_poolalloc.cc
+/// \brief Tests the pool allocator and compares it with malloc
+
+// Checks the size classes and freeing blocks in another thread than
+// the one that allocated them, then times storms of allocations of
+// task-sized objects with malloc and with the pool (freed by the same
+// thread, or handed to another thread to free), and a storm of tasks
+// with futures as in test_world.cc.
+
+using namespace madness;
+
+bool smalltest = false;
+
+void check(bool ok, const char* msg) {
+    if (!ok) {
+        std::cout << "failed: " << msg << std::endl;
+        std::exit(1);
+    }
+}
+
+void test_size_classes() {
+    typedef detail::PoolAlloc P;
+    check(P::size_class(1) == 0 && P::size_class(P::MAXSIZE) == P::NCLASS-1, "class range");
+    for (std::size_t n=1; n<=P::MAXSIZE; ++n) {
+        const int c = P::size_class(n);
+        check(P::class_size(c) >= n, "class too small");
+        check(c == 0 || P::class_size(c-1) < n, "class too big");
+        check(P::class_size(c)%16 == 0, "class alignment");
+    }
+    std::cout << "size classes OK" << std::endl;
+}
+
+/// One thread allocates and fills blocks of every size, another checks and frees them
+void test_cross_thread() {
+    const int nround = smalltest ? 10 : 100;
+    const std::size_t nblock = 2000;
+    for (int round=0; round<nround; ++round) {
+        std::vector<unsigned char*> p(nblock);
+        std::thread producer([&]() {
+            for (std::size_t i=0; i<nblock; ++i) {
+                const std::size_t n = 1 + (i*37)%4000;
+                p[i] = static_cast<unsigned char*>(pool_allocate(n));
+                check((reinterpret_cast<std::size_t>(p[i]) & 15) == 0, "alignment");
+                std::memset(p[i], int(i & 255), n);
+            }
+        });
+        producer.join();
+        std::thread consumer([&]() {
+            for (std::size_t i=0; i<nblock; ++i) {
+                const std::size_t n = 1 + (i*37)%4000;
+                check(p[i][0] == (i & 255) && p[i][n-1] == (i & 255), "contents");
+                pool_deallocate(p[i], n);
+            }
+        });
+        consumer.join();
+    }
+    std::cout << "cross-thread free OK" << std::endl;
+}
+
+/// Each thread repeatedly allocates a batch of task-sized objects and frees them in another order
+template <typename allocT, typename freeT>
+double storm(int nthread, allocT alloc, freeT dealloc) {
+    const int nrep = smalltest ? 2000 : 20000;
+    const int nbatch = 64;
+    double start = wall_time();
+    std::vector<std::thread> threads;
+    for (int t=0; t<nthread; ++t) {
+        threads.emplace_back([=]() {
+            void* p[nbatch];
+            for (int rep=0; rep<nrep; ++rep) {
+                for (int i=0; i<nbatch; ++i) p[i] = alloc(96 + 16*((i*7+rep)%24));
+                for (int i=0; i<nbatch; ++i) {
+                    const int j = (i*5)%nbatch;
+                    dealloc(p[j], 96 + 16*((j*7+rep)%24));
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    return 1e-6*nthread*nrep*nbatch/(wall_time() - start);
+}
+
+/// One thread allocates task-sized objects and passes them to another that frees them
+
+/// This is how the communication thread and the pool threads use
+/// the memory for incoming active messages and tasks.
+template <typename allocT, typename freeT>
+double handoff(allocT alloc, freeT dealloc) {
+    const int n = smalltest ? 200000 : 4000000;
+    const int nring = 1024;
+    std::vector<std::atomic<void*> > ring(nring);
+    for (std::atomic<void*>& r : ring) r = nullptr;
+    double start = wall_time();
+    std::thread producer([&]() {
+        for (int i=0; i<n; ++i) {
+            void* p = alloc(96 + 16*(i%24));
+            std::atomic<void*>& r = ring[i%nring];
+            while (r.load(std::memory_order_acquire)) std::this_thread::yield();
+            r.store(p, std::memory_order_release);
+        }
+    });
+    std::thread consumer([&]() {
+        for (int i=0; i<n; ++i) {
+            std::atomic<void*>& r = ring[i%nring];
+            void* p;
+            while (!(p = r.load(std::memory_order_acquire))) std::this_thread::yield();
+            r.store(nullptr, std::memory_order_release);
+            dealloc(p, 96 + 16*(i%24));
+        }
+    });
+    producer.join();
+    consumer.join();
+    return 1e-6*n/(wall_time() - start);
+}
+
+double task_storm(World& world) {
+    const int ntask = smalltest ? 20000 : 500000;
+    double start = wall_time();
+    std::vector<Future<double> > results;
+    results.reserve(ntask);
+    for (int i=0; i<ntask; ++i)
+        results.push_back(world.taskq.add([](double x) { return 2.0*x; }, double(i)));
+    world.taskq.fence();
+    double sum = 0.0;
+    for (int i=0; i<ntask; ++i) sum += results[i].get();
+    check(sum == double(ntask)*(ntask-1), "task results");
+    return 1e9*(wall_time() - start)/ntask;
+}
+
+int main(int argc, char** argv) {
+    if (getenv("MAD_SMALL_TESTS")) smalltest=true;
+    for (int iarg=1; iarg<argc; iarg++) if (strcmp(argv[iarg],"--small")==0) smalltest=true;
+    std::cout << "small test : " << smalltest << std::endl;
+
+    initialize(argc, argv);
+    {
+        World world(SafeMPI::COMM_WORLD);
+
+        test_size_classes();
+        test_cross_thread();
+
+        std::cout << "\npool in use: " << detail::PoolAlloc::enabled() << "\n";
+        std::cout << "threads    malloc (Mops/s)    pool (Mops/s)\n";
+        const int maxthread = std::max(1u, std::thread::hardware_concurrency());
+        for (int nthread=1; nthread<=maxthread; nthread*=2) {
+            double tmalloc = storm(nthread, [](std::size_t n) { return std::malloc(n); },
+                                   [](void* p, std::size_t) { std::free(p); });
+            double tpool = storm(nthread, [](std::size_t n) { return pool_allocate(n); },
+                                 [](void* p, std::size_t n) { pool_deallocate(p, n); });
+            printf("%7d %18.2f %16.2f\n", nthread, tmalloc, tpool);
+        }
+        printf("handoff %18.2f %16.2f\n",
+               handoff([](std::size_t n) { return std::malloc(n); },
+                       [](void* p, std::size_t) { std::free(p); }),
+               handoff([](std::size_t n) { return pool_allocate(n); },
+                       [](void* p, std::size_t n) { pool_deallocate(p, n); }));
+
+        task_storm(world);  // Warm up
+        std::cout << "\ntask storm: " << task_storm(world)
+                  << " ns/task (set MAD_POOL_ALLOC=0 to compare with the heap)" << std::endl;
+        world_mem_info()->print();
+    }
+    finalize();
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/MADworld.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+/// \file test_taskbatch.cc
+/// \brief Measures per-task overhead of spawning children one by one or as a batch
+
+// Each task spawns NCHILD children until depth NGEN, as a 3-d tree
+// traversal would, either with one WorldTaskQueue::add per child or
+// inside a WorldTaskQueue::Batch.
+
+using namespace madness;
+
+const int NCHILD = 8;
+int NGEN = 6;
+AtomicInt total_count;
+
+class Task : public TaskInterface {
+    const int gen;
+    const bool batched;
+public:
+    Task(int gen, bool batched) : gen(gen), batched(batched) {}
+
+    virtual void run(World& world) {
+        total_count++;
+        if (gen > 0) {
+            if (batched) {
+                WorldTaskQueue::Batch batch(world.taskq);
+                for (int i=0; i<NCHILD; ++i) world.taskq.add(new Task(gen-1, true));
+            }
+            else {
+                for (int i=0; i<NCHILD; ++i) world.taskq.add(new Task(gen-1, false));
+            }
+        }
+    }
+};
+
+long expected_tasks() {
+    long n = 0, level = 1;
+    for (int g=0; g<=NGEN; ++g, level*=NCHILD) n += level;
+    return n;
+}
+
+double run(World& world, bool batched) {
+    total_count = 0;
+    double start = wall_time();
+    world.taskq.add(new Task(NGEN, batched));
+    world.taskq.fence();
+    double used = wall_time() - start;
+
+    std::cout << (batched ? "  batched" : "   single") << ": " << int(total_count)
+              << " tasks in " << used << " s = " << 1e9*used/int(total_count)
+              << " ns/task" << std::endl;
+    if (long(int(total_count)) != expected_tasks()) {
+        std::cout << "expected " << expected_tasks() << " tasks" << std::endl;
+        std::exit(1);
+    }
+    return used;
+}
+
+int main(int argc, char** argv) {
+    bool smalltest = false;
+    if (getenv("MAD_SMALL_TESTS")) smalltest=true;
+    for (int iarg=1; iarg<argc; iarg++) if (strcmp(argv[iarg],"--small")==0) smalltest=true;
+    std::cout << "small test : " << smalltest << std::endl;
+    if (smalltest) NGEN = 4;
+
+    initialize(argc, argv);
+    {
+        World world(SafeMPI::COMM_WORLD);
+
+        // Batched submission must also work from a thread outside the pool
+        {
+            total_count = 0;
+            {
+                WorldTaskQueue::Batch batch(world.taskq);
+                for (int i=0; i<NCHILD; ++i) world.taskq.add(new Task(0, true));
+                MADNESS_CHECK(world.taskq.size() == 0); // Held back until the batch ends
+            }
+            world.taskq.fence();
+            MADNESS_CHECK(int(total_count) == NCHILD);
+        }
+
+        run(world, false); // Warm up the allocator and queues
+        double tsingle = run(world, false);
+        double tbatch = run(world, true);
+        std::cout << "speedup of batched over single submission = " << tsingle/tbatch << std::endl;
+    }
+    finalize();
+
+    return 0;
+}
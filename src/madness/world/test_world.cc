@@ -1179,6 +1179,109 @@ void test15(World& world) {
   world.gop.fence();
 }
 
+// Small active messages to the next process, with an occasional large
+// one to check that aggregation keeps messages in order
+AtomicInt am_nrecv;
+std::vector<long> am_next; // Next sequence no. expected from each process
+bool am_inorder = true;
+
+void am_count_handler(const AmArg& arg) {
+    ProcessID src;
+    long seq;
+    std::vector<double> v;
+    arg & src & seq & v;
+    // Messages from one source are all handled by the same server thread
+    if (seq != am_next[src]) am_inorder = false;
+    am_next[src] = seq + 1;
+    am_nrecv++;
+}
+
+double test_am_rate(World& world, std::size_t aggregate, long nmsg) {
+    const std::size_t saved = world.am.get_aggregation();
+    world.gop.fence();
+    world.am.set_aggregation(aggregate);
+    am_nrecv = 0;
+    am_next.assign(world.size(), 0);
+    world.gop.fence();
+
+    const ProcessID dest = (world.rank() + 1) % world.size();
+    const std::vector<double> small, large(4096, 1.0);
+    double start = wall_time();
+    for (long i=0; i<nmsg; ++i) {
+        world.am.send(dest, am_count_handler, new_am_arg(world.rank(), i, (i%997) ? small : large));
+    }
+    // Without a fence the last aggregate is sent by the server thread after the timeout
+    World::await([nmsg]() { return am_nrecv == nmsg; });
+    double used = wall_time() - start;
+    world.gop.fence();
+
+    MADNESS_CHECK(am_nrecv == nmsg);
+    MADNESS_CHECK(am_inorder);
+    world.am.set_aggregation(saved);
+    return used;
+}
+
+void test_am_aggregate(World& world) {
+    if (world.size() > 1) {
+        const long nmsg = 20000;
+        const unsigned long nagg = world.am.get_naggregated();
+        double tplain = test_am_rate(world, 0, nmsg);
+        double tagg = test_am_rate(world, 65536, nmsg);
+        MADNESS_CHECK(world.am.get_naggregated() > nagg);
+
+        if (world.rank() == 0) {
+            print("AM rate without aggregation", nmsg/tplain, "msg/s");
+            print("AM rate with aggregation   ", nmsg/tagg, "msg/s");
+            print("speedup of aggregation", tplain/tagg);
+            AmSendStats st = world.am.get_send_stats();
+            print("AM send slots", st.nsend, "max pending", st.nmax, "#grow", st.ngrow, "#stall", st.nstall);
+            print("test_am_aggregate OK");
+        }
+    }
+    world.gop.fence();
+}
+
+// Non-blocking collectives overlapped with tasks; several are in flight at once
+double nb_square(double x) {
+    return x*x;
+}
+
+struct NbSumOp {
+    typedef double result_type;
+    typedef double argument_type;
+    double operator()() const { return 0.0; }
+    void operator()(double& result, const double& arg) const { result += arg; }
+};
+
+void test_nonblocking_gop(World& world) {
+    const long n = 100;
+    const double me = world.rank() + 1;
+    const double nproc = world.size();
+
+    std::vector<double> a(n, me), b(n, me);
+    Future<bool> fsum = world.gop.isum(a.data(), n);
+    Future<bool> fmax = world.gop.imax(b.data(), n);
+
+    // The input to a reduction may itself be the result of a task
+    Future<double> x = world.taskq.add(nb_square, me);
+    Future<double> fred = world.gop.ireduce(x, NbSumOp());
+
+    Future<long> fbc = world.gop.ibroadcast(world.rank() == 0 ? 42l : -1l, 0);
+
+    world.gop.fence();
+    fsum.get();
+    fmax.get();
+    for (long i=0; i<n; ++i) {
+        MADNESS_CHECK(a[i] == nproc*(nproc+1)/2);
+        MADNESS_CHECK(b[i] == nproc);
+    }
+    MADNESS_CHECK(fred.get() == nproc*(nproc+1)*(2*nproc+1)/6);
+    MADNESS_CHECK(fbc.get() == 42);
+
+    if (world.rank() == 0) print("test_nonblocking_gop OK");
+    world.gop.fence();
+}
+
 inline bool is_odd(int i) {
     return i & 0x1;
 }
@@ -1352,6 +1455,8 @@ int main(int argc, char** argv) {
         test13(world);
         test14(world);
         test15(world);
+        test_am_aggregate(world);
+        test_nonblocking_gop(world);
 
         for (int i=0; i<10; ++i) {
           print("REPETITION",i);
@@ -0,0 +1,226 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#include <madness/world/thread.h>
+#include <madness/world/dqueue.h>
+#include <madness/world/wsdeque.h>
+#include <madness/world/timers.h>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/// \file test_wsqueue.cc
+/// \brief Contention benchmark comparing the shared DQueue with per-thread work-stealing deques
+
+// Each item is a node in a binary tree of depth NGEN, mimicking the
+// 2^NDIM-way child spawning of MRA tree traversals.  Consuming an item
+// of generation g>0 produces two items of generation g-1.  Items are
+// encoded as unique non-zero integers (DQueue treats zero as a stolen
+// task and consecutive duplicates as copies of a multi-threaded task).
+
+using namespace madness;
+
+typedef std::uint64_t itemT;
+
+int NGEN = 16;
+int NROOT = 64;
+const int NMAXPOP = 128;
+
+std::atomic<long> noutstanding; // Items pushed but not yet consumed
+
+itemT make_item(std::uint64_t& serial, int gen) {
+    return ((serial++) << 6) | std::uint64_t(gen + 1);
+}
+
+int generation(itemT item) {
+    return int(item & 63) - 1;
+}
+
+long expected_items() {
+    return long(NROOT) * ((1l << (NGEN + 1)) - 1);
+}
+
+struct Worker {
+    int id;
+    int nthread;
+    std::uint64_t serial;
+    long count;
+    void* queue;
+};
+
+// Shared DQueue path, as used by the default ThreadPool
+void* dqueue_main(void* args) {
+    Worker* w = static_cast<Worker*>(args);
+    DQueue<itemT>* q = static_cast<DQueue<itemT>*>(w->queue);
+    itemT buf[NMAXPOP];
+    while (noutstanding.load() > 0) {
+        int n = q->pop_front(NMAXPOP, buf, false);
+        for (int i=0; i<n; ++i) {
+            int gen = generation(buf[i]);
+            if (gen > 0) {
+                noutstanding += 2;
+                q->push_back(make_item(w->serial, gen-1));
+                q->push_back(make_item(w->serial, gen-1));
+            }
+            ++(w->count);
+            --noutstanding;
+        }
+        if (n == 0) cpu_relax();
+    }
+    return 0;
+}
+
+// Work-stealing path, LIFO local pops and FIFO steals
+void* wsdeque_main(void* args) {
+    Worker* w = static_cast<Worker*>(args);
+    WSDeque<itemT>* deques = static_cast<WSDeque<itemT>*>(w->queue);
+    WSDeque<itemT>& mine = deques[w->id];
+    unsigned int seed = 2654435761u*(w->id+1);
+    itemT item;
+    while (noutstanding.load() > 0) {
+        bool got = mine.pop(item);
+        if (!got) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            int start = seed % w->nthread;
+            for (int i=0; i<w->nthread && !got; ++i) {
+                int victim = (start + i) % w->nthread;
+                if (victim != w->id) got = deques[victim].steal(item);
+            }
+        }
+        if (got) {
+            int gen = generation(item);
+            if (gen > 0) {
+                noutstanding += 2;
+                mine.push(make_item(w->serial, gen-1));
+                mine.push(make_item(w->serial, gen-1));
+            }
+            ++(w->count);
+            --noutstanding;
+        }
+        else {
+            cpu_relax();
+        }
+    }
+    return 0;
+}
+
+double run(const char* name, int nthread, void* (*f)(void*), void* queue,
+           void (*seed)(void*, Worker&)) {
+    std::vector<Worker> workers(nthread);
+    for (int i=0; i<nthread; ++i) {
+        workers[i].id = i;
+        workers[i].nthread = nthread;
+        workers[i].serial = std::uint64_t(i) << 40;
+        workers[i].count = 0;
+        workers[i].queue = queue;
+    }
+    noutstanding = 0;
+
+    // Roots are pushed before the threads start, as if by the main thread
+    seed(queue, workers[0]);
+
+    std::vector<std::thread> threads;
+    double start = wall_time();
+    for (int i=0; i<nthread; ++i) threads.emplace_back(f, &workers[i]);
+    for (int i=0; i<nthread; ++i) threads[i].join();
+    double used = wall_time() - start;
+
+    long total = 0;
+    for (int i=0; i<nthread; ++i) total += workers[i].count;
+    std::cout << name << ": " << total << " items in " << used << " s = "
+              << 1e9*used/total << " ns/item\n";
+    std::cout << "   items per thread:";
+    for (int i=0; i<nthread; ++i) std::cout << " " << workers[i].count;
+    std::cout << std::endl;
+    if (total != expected_items()) {
+        std::cout << name << ": expected " << expected_items() << " items\n";
+        std::exit(1);
+    }
+    return used;
+}
+
+void seed_dqueue(void* queue, Worker& w) {
+    DQueue<itemT>* q = static_cast<DQueue<itemT>*>(queue);
+    for (int i=0; i<NROOT; ++i) {
+        ++noutstanding;
+        q->push_back(make_item(w.serial, NGEN));
+    }
+}
+
+void seed_wsdeque(void* queue, Worker& w) {
+    WSDeque<itemT>* deques = static_cast<WSDeque<itemT>*>(queue);
+    for (int i=0; i<NROOT; ++i) {
+        ++noutstanding;
+        deques[0].push(make_item(w.serial, NGEN));
+    }
+}
+
+int main(int argc, char** argv) {
+    bool smalltest = false;
+    if (getenv("MAD_SMALL_TESTS")) smalltest=true;
+    for (int iarg=1; iarg<argc; iarg++) if (strcmp(argv[iarg],"--small")==0) smalltest=true;
+    std::cout << "small test : " << smalltest << std::endl;
+    if (smalltest) {
+        NGEN = 10;
+        NROOT = 16;
+    }
+
+    int nthread = ThreadBase::num_hw_processors();
+    const char* cnthread = getenv("MAD_NUM_THREADS");
+    if (cnthread) nthread = atoi(cnthread);
+    if (nthread < 2) nthread = 2;
+
+    std::cout << "threads = " << nthread << "  items = " << expected_items() << std::endl;
+
+    double tdq, tws;
+    {
+        DQueue<itemT> q;
+        tdq = run("     DQueue", nthread, dqueue_main, &q, seed_dqueue);
+        const DQStats& s = q.get_stats();
+        std::cout << "   npush_back " << s.npush_back << " npop_front " << s.npop_front
+                  << " nmax " << s.nmax << std::endl;
+    }
+    {
+        std::vector<WSDeque<itemT>> deques(nthread);
+        tws = run("    WSDeque", nthread, wsdeque_main, deques.data(), seed_wsdeque);
+        WSDequeStats s;
+        for (int i=0; i<nthread; ++i) s += deques[i].get_stats();
+        std::cout << "   npush " << s.npush << " npop " << s.npop << " nsteal " << s.nsteal
+                  << " nsteal_fail " << s.nsteal_fail << " ngrow " << s.ngrow << std::endl;
+    }
+    std::cout << "speedup of work stealing over DQueue = " << tdq/tws << std::endl;
+
+    return 0;
+}
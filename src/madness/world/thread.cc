@@ -43,8 +43,11 @@
 #include <madness/world/worldpapi.h>
 #include <madness/world/safempi.h>
 #include <madness/world/atomicint.h>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <sstream>
+#include <string>
 
 #if defined(HAVE_IBMBGQ) and defined(HPM)
 extern "C" unsigned int HPM_Prof_init_thread(void);
@@ -74,6 +77,19 @@ namespace madness {
 
     ThreadPool* ThreadPool::instance_ptr = 0;
     double ThreadPool::await_timeout = 900.0;
+    WaitPolicy ThreadPool::await_policy = WaitPolicy::Busy;
+    int ThreadPool::await_usleep = 100;
+    std::atomic<int> ThreadPool::nparked{0};
+    std::atomic<std::uint64_t> ThreadPool::park_epoch{0};
+    std::atomic<std::int64_t> ThreadPool::notify_stamp{0};
+    std::mutex ThreadPool::park_mutex;
+    std::condition_variable ThreadPool::park_cv;
+    std::atomic<std::uint64_t> ThreadPool::await_nidle{0};
+    std::atomic<std::uint64_t> ThreadPool::await_npark{0};
+    std::atomic<std::uint64_t> ThreadPool::await_nwakeup{0};
+    std::atomic<std::uint64_t> ThreadPool::await_idle_ns{0};
+    std::atomic<std::uint64_t> ThreadPool::await_wakeup_ns{0};
+    std::atomic<std::uint64_t> ThreadPool::await_max_wakeup_ns{0};
 #if HAVE_INTEL_TBB
     std::unique_ptr<tbb::global_control> ThreadPool::tbb_control = nullptr;
 #endif
@@ -203,6 +219,76 @@ namespace madness {
 #endif
     }
 
+    namespace {
+
+        // Parse a Linux cpulist such as "0-3,8-11" into a list of ids
+        std::vector<int> parse_cpulist(const std::string& list) {
+            std::vector<int> ids;
+            std::istringstream ss(list);
+            std::string range;
+            while (std::getline(ss, range, ',')) {
+                int lo, hi;
+                const int n = sscanf(range.c_str(), "%d-%d", &lo, &hi);
+                if (n < 1) continue;
+                if (n == 1) hi = lo;
+                for (int i=lo; i<=hi; ++i) ids.push_back(i);
+            }
+            return ids;
+        }
+
+        // CPUs of each NUMA domain, discovered on first use
+        const std::vector<std::vector<int>>& numa_topology() {
+            static const std::vector<std::vector<int>> topology = [] {
+                std::vector<std::vector<int>> domains;
+                std::string online;
+                std::ifstream fonline("/sys/devices/system/node/online");
+                if (fonline && std::getline(fonline, online)) {
+                    for (int node : parse_cpulist(online)) {
+                        std::ifstream fcpus("/sys/devices/system/node/node" +
+                                            std::to_string(node) + "/cpulist");
+                        std::string cpus;
+                        if (fcpus && std::getline(fcpus, cpus)) {
+                            std::vector<int> ids = parse_cpulist(cpus);
+                            if (!ids.empty()) domains.push_back(ids); // Skip memory-only nodes
+                        }
+                    }
+                }
+                if (domains.empty()) {
+                    // One domain holding every processor
+                    domains.resize(1);
+                    for (int i=0; i<ThreadBase::num_hw_processors(); ++i)
+                        domains[0].push_back(i);
+                }
+                return domains;
+            }();
+            return topology;
+        }
+
+    } // namespace
+
+    int ThreadBase::num_numa_domains() {
+        return numa_topology().size();
+    }
+
+    const std::vector<int>& ThreadBase::numa_domain_cpus(int domain) {
+        const std::vector<std::vector<int>>& topology = numa_topology();
+        MADNESS_ASSERT(domain >= 0 && domain < int(topology.size()));
+        return topology[domain];
+    }
+
+    void ThreadBase::bind_to_cpus(const std::vector<int>& cpus) {
+        if (cpus.empty()) return;
+#ifndef ON_A_MAC
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int cpu : cpus) CPU_SET(cpu,&mask);
+        if (sched_setaffinity(0, sizeof(mask), &mask) == -1) {
+            perror("system error message");
+            std::cout << "ThreadBase: bind_to_cpus: Could not set cpu affinity" << std::endl;
+        }
+#endif
+    }
+
     // Specify the affinity pattern or how to bind threads to cpus
     void ThreadBase::set_affinity_pattern(const bool bind[3], const int cpu[3]) {
         memcpy(ThreadBase::bind, bind, 3*sizeof(bool));
@@ -341,12 +427,17 @@ namespace madness {
 #endif
     // The constructor is private to enforce the singleton model
     ThreadPool::ThreadPool(int nthread) :
-            threads(nullptr), main_thread(), nthreads(nthread), finish(false)
+            threads(nullptr), main_thread(), nthreads(nthread), finish(false),
+            policy(default_scheduler_policy()), idle_policy(WaitPolicy::Busy),
+            idle_usleep(0), ndomains(1), domain_queues(), ndomain_steals(0)
     {
         nfinished = 0;
         instance_ptr = this;
         if (nthreads < 0) nthreads = default_nthread();
         MADNESS_ASSERT(nthreads >= 0);
+#if HAVE_PARSEC || HAVE_INTEL_TBB
+        policy = SchedulerPolicy::Queue; // Only the Pthreads pool can steal
+#endif
 
         const int rc = pthread_setspecific(ThreadBase::thread_key,
                 static_cast<void*>(&main_thread));
@@ -401,6 +492,25 @@ namespace madness {
             MADNESS_EXCEPTION("memory allocation failed", 0);
         }
 
+        // Deques must all exist before any thread starts looking for victims
+        if (policy == SchedulerPolicy::WorkStealing) {
+            for (int i=0; i<nthreads; ++i) {
+                threads[i].deque_.reset(new WSDeque<PoolTaskInterface*>());
+                threads[i].steal_seed_ = 2654435761u*(i+1);
+            }
+        }
+
+        // Threads are assigned to domains in contiguous blocks.  Since the
+        // shared DQueue uses the thread-local prebuffer, the domain queues
+        // must not.
+        if (policy == SchedulerPolicy::NUMA) {
+            ndomains = std::max(1, std::min(ThreadBase::num_numa_domains(), nthreads));
+            for (int d=0; d<ndomains; ++d)
+                domain_queues.emplace_back(new DQueue<PoolTaskInterface*>(200000, false));
+            for (int i=0; i<nthreads; ++i)
+                threads[i].domain_ = (i*ndomains)/nthreads;
+        }
+
         for (int i=0; i<nthreads; ++i) {
             threads[i].set_pool_thread_index(i);
             threads[i].start(pool_thread_main, (void *)(threads+i));
@@ -434,9 +544,24 @@ namespace madness {
         return nthread;
     }
 
+    // Get the scheduler policy from the environment
+    SchedulerPolicy ThreadPool::default_scheduler_policy() {
+        const char* scheduler = getenv("MAD_TASK_SCHEDULER");
+        if (!scheduler || strcmp(scheduler, "queue") == 0)
+            return SchedulerPolicy::Queue;
+        if (strcmp(scheduler, "workstealing") == 0 || strcmp(scheduler, "ws") == 0)
+            return SchedulerPolicy::WorkStealing;
+        if (strcmp(scheduler, "numa") == 0)
+            return SchedulerPolicy::NUMA;
+        MADNESS_EXCEPTION("MAD_TASK_SCHEDULER must be one of queue, workstealing or numa", 0);
+    }
+
     void ThreadPool::thread_main(ThreadPoolThread* const thread) {
         PROFILE_MEMBER_FUNC(ThreadPool);
         thread->set_affinity(2, thread->get_pool_thread_index());
+        // An explicit MAD_BIND of the pool threads takes precedence
+        if (thread->domain_ >= 0 && !ThreadBase::bind[2])
+            ThreadBase::bind_to_cpus(ThreadBase::numa_domain_cpus(thread->domain_));
 
 #if !HAVE_PARSEC
 #define MULTITASK
@@ -473,6 +598,16 @@ namespace madness {
         // Construct the thread pool singleton
         instance_ptr = new ThreadPool(nthread);
 
+#if !(HAVE_INTEL_TBB || HAVE_PARSEC)
+        if (instance_ptr->policy == SchedulerPolicy::WorkStealing &&
+            SafeMPI::COMM_WORLD.Get_rank() == 0 && !madness::quiet())
+            std::cout << "MADNESS task scheduler set to work stealing.\n";
+        if (instance_ptr->policy == SchedulerPolicy::NUMA &&
+            SafeMPI::COMM_WORLD.Get_rank() == 0 && !madness::quiet())
+            std::cout << "MADNESS task scheduler set to NUMA with "
+                      << instance_ptr->ndomains << " domain(s).\n";
+#endif
+
         const char* mad_wait_timeout = getenv("MAD_WAIT_TIMEOUT");
         if(mad_wait_timeout) {
             std::stringstream ss(mad_wait_timeout);
@@ -556,6 +691,74 @@ namespace madness {
         return instance()->queue.get_stats();
     }
 
+    // Returns work-stealing statistics summed over the pool threads
+    WSDequeStats ThreadPool::get_ws_stats() {
+        WSDequeStats stats;
+        ThreadPool* const pool = instance();
+        if (pool->policy == SchedulerPolicy::WorkStealing) {
+            for (int i=0; i<pool->nthreads; ++i)
+                stats += pool->threads[i].deque_->get_stats();
+        }
+        return stats;
+    }
+
+    namespace {
+        // Monotonic time in nanoseconds, comparable between threads
+        std::int64_t steady_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    void ThreadPool::wake_waiters() {
+        {
+            std::lock_guard<std::mutex> lock(park_mutex);
+            notify_stamp.store(steady_ns(), std::memory_order_relaxed);
+            park_epoch.fetch_add(1, std::memory_order_relaxed);
+        }
+        park_cv.notify_all();
+    }
+
+    void ThreadPool::parked(bool woken) {
+        await_npark.fetch_add(1, std::memory_order_relaxed);
+        if (woken) {
+            await_nwakeup.fetch_add(1, std::memory_order_relaxed);
+            const std::int64_t latency = steady_ns() - notify_stamp.load(std::memory_order_relaxed);
+            if (latency > 0) {
+                const std::uint64_t ns = latency;
+                await_wakeup_ns.fetch_add(ns, std::memory_order_relaxed);
+                std::uint64_t max = await_max_wakeup_ns.load(std::memory_order_relaxed);
+                while (ns > max && !await_max_wakeup_ns.compare_exchange_weak(max, ns,
+                        std::memory_order_relaxed)) ;
+            }
+        }
+    }
+
+    AwaitStats ThreadPool::get_await_stats() {
+        AwaitStats stats;
+        stats.nidle = await_nidle.load(std::memory_order_relaxed);
+        stats.npark = await_npark.load(std::memory_order_relaxed);
+        stats.nwakeup = await_nwakeup.load(std::memory_order_relaxed);
+        stats.idle_time = 1e-9*await_idle_ns.load(std::memory_order_relaxed);
+        stats.wakeup_latency = 1e-9*await_wakeup_ns.load(std::memory_order_relaxed);
+        stats.max_wakeup_latency = 1e-9*await_max_wakeup_ns.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // Returns statistics summed over the per-domain queues
+    DQStats ThreadPool::get_domain_stats() {
+        DQStats stats;
+        for (const auto& q : instance()->domain_queues) {
+            const DQStats& s = q->get_stats();
+            stats.npush_back += s.npush_back;
+            stats.npush_front += s.npush_front;
+            stats.npop_front += s.npop_front;
+            stats.ngrow += s.ngrow;
+            stats.nmax = std::max(stats.nmax, s.nmax);
+        }
+        return stats;
+    }
+
 #if defined(MADNESS_DQ_USE_PREBUF) && defined(MADNESS_CXX_COMPILER_IS_ICC)
     thread_local PoolTaskInterface* DQueue<PoolTaskInterface*>::prebuf[DQueue<PoolTaskInterface*>::NPREBUF] = {};
     thread_local PoolTaskInterface* DQueue<PoolTaskInterface*>::prebufhi[DQueue<PoolTaskInterface*>::NPREBUF] = {};
@@ -40,7 +40,16 @@
 
 #include <madness/world/thread_info.h>
 #include <madness/world/dqueue.h>
+#include <madness/world/wsdeque.h>
 #include <madness/world/function_traits.h>
+#include <madness/world/pool_alloc.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <cstddef>
 #include <cstdio>
@@ -196,6 +205,24 @@ namespace madness {
         /// \return The number of hardward processors.
         static int num_hw_processors();
 
+        /// Get the number of NUMA domains.
+
+        /// On Linux the topology is read from sysfs; elsewhere, or if that
+        /// fails, the machine is treated as a single domain.
+        /// \return The number of NUMA domains.
+        static int num_numa_domains();
+
+        /// Get the CPUs in a NUMA domain.
+
+        /// \param[in] domain The domain index, `0 <= domain < num_numa_domains()`.
+        /// \return The CPU ids, empty if unknown.
+        static const std::vector<int>& numa_domain_cpus(int domain);
+
+        /// Bind the calling thread to a set of CPUs.
+
+        /// \param[in] cpus The CPU ids; nothing is done if this is empty.
+        static void bind_to_cpus(const std::vector<int>& cpus);
+
         /// Specify the affinity pattern or how to bind threads to CPUs.
 
         /// \todo Descriptions needed.
@@ -280,6 +307,11 @@ namespace madness {
     /// - \c nthread : indicates number of threads. 0 threads is interpreted
     ///   as 1 thread for backward compatibility and ease of specifying
     ///   defaults. The default value is 0 (==1).
+    /// - \c affinity : an optional locality hint, typically the hash of the
+    ///   key of the data the task updates. Tasks with equal hints are
+    ///   preferentially run on the same NUMA domain when the thread pool
+    ///   uses \c SchedulerPolicy::NUMA, otherwise the hint is ignored. By
+    ///   default there is no hint.
     class TaskAttributes {
         unsigned long flags; ///< Byte-string storing the specified attributes.
 
@@ -288,6 +320,8 @@ namespace madness {
         static const unsigned long GENERATOR = 1ul<<8; ///< Mask for generator bit.
         static const unsigned long STEALABLE = GENERATOR<<1; ///< Mask for stealable bit.
         static const unsigned long HIGHPRIORITY = GENERATOR<<2; ///< Mask for priority bit.
+        static const int AFFINITY_SHIFT = 16; ///< Position of the affinity hint.
+        static const unsigned long AFFINITY = 0xfffful<<AFFINITY_SHIFT; ///< Mask for affinity hint (stored plus one, zero means no hint).
 
         /// Sets the attributes to the desired values.
 
@@ -383,6 +417,35 @@ namespace madness {
         	return n;
         }
 
+        /// Sets the affinity hint.
+
+        /// Only the low bits of \c hint are kept so any hash value may be
+        /// passed directly.
+        /// \param[in] hint The new affinity hint.
+        void set_affinity_hint(std::size_t hint) {
+            const unsigned long h = (hint % 0xfffful) + 1;
+            flags = (flags & (~AFFINITY)) | (h << AFFINITY_SHIFT);
+        }
+
+        /// Removes the affinity hint.
+        void clear_affinity_hint() {
+            flags &= ~AFFINITY;
+        }
+
+        /// Test if an affinity hint was given.
+
+        /// \return True if this task has an affinity hint, false otherwise.
+        bool has_affinity_hint() const {
+            return flags&AFFINITY;
+        }
+
+        /// Get the affinity hint.
+
+        /// \return The affinity hint, only meaningful if \c has_affinity_hint().
+        std::size_t get_affinity_hint() const {
+            return ((flags & AFFINITY) >> AFFINITY_SHIFT) - 1;
+        }
+
         /// Serializes the attributes for I/O.
 
         /// tparam Archive The archive type.
@@ -417,6 +480,16 @@ namespace madness {
             t.set_nthread(nthread);
             return t;
         }
+
+        /// Attributes with only the affinity hint set.
+
+        /// \param[in] hint The affinity hint, e.g. the hash of a key.
+        /// \return The attributes.
+        static TaskAttributes affinity(std::size_t hint) {
+            TaskAttributes t;
+            t.set_affinity_hint(hint);
+            return t;
+        }
     };
 
     /// Used to pass information about the thread environment to a user's task.
@@ -823,6 +896,8 @@ namespace madness {
     class PoolTaskInterface :
 #ifdef HAVE_INTEL_TBB
             public tbb::task,
+#else
+            public PoolAllocated, // Tasks are created and deleted at a great rate
 #endif // HAVE_INTEL_TBB
             public TaskAttributes
     {
@@ -1124,13 +1199,18 @@ namespace madness {
     /// accessed via \c ThreadBase::this_thread().
     class ThreadPoolThread : public Thread {
     private:
+        friend class ThreadPool;
+
         // Thread local data for thread pool
 #ifdef MADNESS_TASK_PROFILING
         profiling::TaskProfiler profiler_; ///< \todo Description needed.
 #endif // MADNESS_TASK_PROFILING
+        std::unique_ptr<WSDeque<PoolTaskInterface*>> deque_; ///< Local task deque, only allocated when work stealing.
+        unsigned int steal_seed_; ///< State of the victim-selection generator used when work stealing.
+        int domain_; ///< NUMA domain of this thread, or -1 if not using the NUMA policy.
 
     public:
-        ThreadPoolThread() : Thread() { }
+        ThreadPoolThread() : Thread(), deque_(), steal_seed_(0), domain_(-1) { }
         virtual ~ThreadPoolThread() = default;
 
 #ifdef MADNESS_TASK_PROFILING
@@ -1144,6 +1224,45 @@ namespace madness {
 #endif // MADNESS_TASK_PROFILING
     };
 
+    /// Task scheduling policies supported by the Pthreads \c ThreadPool.
+
+    /// - \c SchedulerPolicy::Queue -- all tasks pass through one shared
+    ///   \c DQueue (default).
+    /// - \c SchedulerPolicy::WorkStealing -- each pool thread owns a
+    ///   \c WSDeque onto which it pushes the tasks it spawns and from
+    ///   which it pops in LIFO order; idle threads steal in FIFO order
+    ///   from the other threads. The shared \c DQueue remains as the
+    ///   injection queue for tasks submitted by the main and RMI server
+    ///   threads, high-priority tasks and multi-threaded tasks, and is
+    ///   always checked first.
+    ///
+    /// - \c SchedulerPolicy::NUMA -- pool threads are bound to NUMA
+    ///   domains and each domain has its own \c DQueue. Tasks with an
+    ///   affinity hint (see \c TaskAttributes) go to the queue of domain
+    ///   `hint % ndomain`; other tasks go to the shared \c DQueue. A
+    ///   thread takes work from its own domain, then the shared queue, and
+    ///   only when both are empty from another domain.
+    ///
+    /// The policy is chosen at startup with the environment variable
+    /// `MAD_TASK_SCHEDULER` (`queue`, `workstealing` or `numa`).
+    enum class SchedulerPolicy {
+      Queue = 1, WorkStealing, NUMA
+    };
+
+    /// Statistics of the threads waiting in \c ThreadPool::await.
+    struct AwaitStats {
+        std::uint64_t nidle;    ///< #times a waiting thread ran out of work
+        std::uint64_t npark;    ///< #times a waiting thread parked (\c WaitPolicy::Adaptive only)
+        std::uint64_t nwakeup;  ///< #parks ended by a notification rather than a timeout
+        double idle_time;       ///< Total time (s) waiting threads spent without work
+        double wakeup_latency;  ///< Total time (s) from notification to resumption of parked threads
+        double max_wakeup_latency; ///< Longest such time (s)
+
+        AwaitStats()
+                : nidle(0), npark(0), nwakeup(0), idle_time(0.0)
+                , wakeup_latency(0.0), max_wakeup_latency(0.0) {}
+    };
+
     /// A singleton pool of threads for dynamic execution of tasks.
 
     /// \attention You must instantiate the pool while running with just one
@@ -1166,11 +1285,34 @@ namespace madness {
         int nthreads; ///< Number of threads.
         volatile bool finish; ///< Set to true when time to stop.
         AtomicInt nfinished; ///< Thread pool exit counter.
+        SchedulerPolicy policy; ///< How tasks are distributed among threads.
+        WaitPolicy idle_policy; ///< How a work-stealing or NUMA thread waits when it finds no work.
+        int idle_usleep; ///< Sleep duration when \c idle_policy is \c WaitPolicy::Sleep.
+        int ndomains; ///< Number of NUMA domains used by the pool (NUMA policy only).
+        std::vector<std::unique_ptr<DQueue<PoolTaskInterface*>>> domain_queues; ///< Queue of hinted tasks for each domain (NUMA policy only).
+        std::atomic<std::uint64_t> ndomain_steals; ///< #tasks taken from another domain's queue (NUMA policy only).
 
         // Static data
         static ThreadPool* instance_ptr; ///< Singleton pointer.
         static const int nmax = 128; ///< Number of task a worker thread will pop from the task queue
         static double await_timeout; ///< Waiter timeout.
+        static WaitPolicy await_policy; ///< How \c await waits when there is no work.
+        static int await_usleep; ///< Sleep or park duration in \c await, in microseconds.
+
+        // Parking of waiting threads (WaitPolicy::Adaptive)
+        static std::atomic<int> nparked; ///< #threads parked in \c await.
+        static std::atomic<std::uint64_t> park_epoch; ///< Bumped by every notification.
+        static std::atomic<std::int64_t> notify_stamp; ///< Time (ns) of the latest notification.
+        static std::mutex park_mutex; ///< Protects parking.
+        static std::condition_variable park_cv; ///< Parked threads wait on this.
+
+        // Statistics of await
+        static std::atomic<std::uint64_t> await_nidle; ///< See \c AwaitStats.
+        static std::atomic<std::uint64_t> await_npark; ///< See \c AwaitStats.
+        static std::atomic<std::uint64_t> await_nwakeup; ///< See \c AwaitStats.
+        static std::atomic<std::uint64_t> await_idle_ns; ///< See \c AwaitStats.
+        static std::atomic<std::uint64_t> await_wakeup_ns; ///< See \c AwaitStats.
+        static std::atomic<std::uint64_t> await_max_wakeup_ns; ///< See \c AwaitStats.
 
 #if defined(HAVE_IBMBGQ) and defined(HPM)
         static unsigned int main_hpmctx; ///< HPM context for main thread.
@@ -1186,32 +1328,181 @@ namespace madness {
         /// \return The number of threads.
         int default_nthread();
 
-       /// Run the next task.
+        /// Get the scheduler policy from the environment.
 
-        /// \todo Verify and complete this documentation.
-        /// \param[in] wait Block of true.
-        /// \param[in,out] this_thread Description needed.
-        /// \return True if a task was run.
-        bool run_task(bool wait, ThreadPoolThread* this_thread) {
-#if HAVE_INTEL_TBB
-            MADNESS_EXCEPTION("run_task should not be called when using Intel TBB", 1);
-#else
+        /// \return The scheduler policy.
+        static SchedulerPolicy default_scheduler_policy();
+
+        /// Park the calling thread until notified or \c await_usleep expires.
+
+        /// \tparam Probe Type of the probe.
+        /// \param[in] probe The probe, checked again once parking is announced.
+        template <typename Probe>
+        static void park(const Probe& probe) {
+            nparked.fetch_add(1, std::memory_order_seq_cst);
+            const std::uint64_t epoch = park_epoch.load(std::memory_order_seq_cst);
+            if (!probe()) {
+                bool woken;
+                {
+                    std::unique_lock<std::mutex> lock(park_mutex);
+                    woken = park_cv.wait_for(lock, std::chrono::microseconds(await_usleep),
+                            [epoch] { return park_epoch.load(std::memory_order_relaxed) != epoch; });
+                }
+                parked(woken);
+            }
+            nparked.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        /// Wake all parked threads.
+        static void wake_waiters();
 
-            if (!wait && queue.empty()) return false;
-            std::pair<PoolTaskInterface*,bool> t = queue.pop_front(wait);
+        /// Record the end of a park.
+
+        /// \param[in] woken True if the park was ended by a notification.
+        static void parked(bool woken);
+
+        /// Returns the pool thread calling this, or \c nullptr for any other thread.
+        static ThreadPoolThread* this_pool_thread() {
+            ThreadBase* thread = ThreadBase::this_thread();
+            if (thread && thread->get_pool_thread_index() >= 0)
+                return static_cast<ThreadPoolThread*>(thread);
+            return nullptr;
+        }
+
+        /// Try to steal up to one task from another pool thread.
+
+        /// Victims are visited round robin starting from a pseudo-random
+        /// thread so that thieves spread out.
+        /// \param[in,out] this_thread The thief, or \c nullptr if it is not a pool thread.
+        /// \param[out] task The stolen task.
+        /// \return True if a task was stolen.
+        bool steal_task(ThreadPoolThread* const this_thread, PoolTaskInterface*& task) {
+            if (nthreads == 0) return false;
+            int start;
+            if (this_thread) {
+                // xorshift ... quality is irrelevant, it only needs to be cheap
+                unsigned int x = this_thread->steal_seed_;
+                x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+                this_thread->steal_seed_ = x;
+                start = int(x % (unsigned int)(nthreads));
+            }
+            else {
+                start = 0;
+            }
+            for (int i=0; i<nthreads; ++i) {
+                ThreadPoolThread& victim = threads[(start + i) % nthreads];
+                if (&victim == this_thread) continue;
+                if (!victim.deque_->empty() && victim.deque_->steal(task))
+                    return true;
+            }
+            return false;
+        }
+
+        /// Back off after a work-stealing thread failed to find any work.
+        void idle_wait() const {
+            switch (idle_policy) {
+              case WaitPolicy::Adaptive:
+              case WaitPolicy::Yield:
+                std::this_thread::yield();
+                break;
+              case WaitPolicy::Sleep:
+                myusleep(idle_usleep);
+                break;
+              default:
+                for (int i=0; i<300; ++i) cpu_relax();
+            }
+        }
+
+        /// Run tasks that were taken from a queue or deque.
+
+        /// \param[in] ntask The number of tasks.
+        /// \param[in] taskbuf The tasks.
+        /// \param[in,out] this_thread The calling pool thread or \c nullptr.
+        void execute_tasks(int ntask, PoolTaskInterface* const* taskbuf,
+                           ThreadPoolThread* const this_thread) {
 #ifdef MADNESS_TASK_PROFILING
             profiling::TaskEventList* event_list =
-                    this_thread->profiler().new_list(1);
+                    this_thread->profiler().new_list(ntask);
 #endif // MADNESS_TASK_PROFILING
-            // Task pointer might be zero due to stealing
-            if (t.second && t.first) {
+            for (int i=0; i<ntask; ++i) {
+                if (taskbuf[i]) { // Task pointer might be zero due to stealing
 #ifdef MADNESS_TASK_PROFILING
-                t.first->set_event(event_list->event());
+                    taskbuf[i]->set_event(event_list->event());
 #endif // MADNESS_TASK_PROFILING
-                if (t.first->run_multi_threaded())         // What we are here to do
-                    delete t.first;
+                    if (taskbuf[i]->run_multi_threaded()) {
+                        delete taskbuf[i];
+                    }
+                }
+            }
+        }
+
+        /// Run tasks using the work-stealing policy.
+
+        /// Tasks are taken from the shared injection queue if it holds
+        /// anything (so high-priority and multi-threaded tasks are not
+        /// starved), otherwise from the bottom of this thread's own deque,
+        /// otherwise stolen from another thread.
+        /// \param[in] wait If true, back off when no work was found.
+        /// \param[in,out] this_thread The calling pool thread or \c nullptr.
+        /// \return True if any task was run.
+        bool run_tasks_stealing(bool wait, ThreadPoolThread* const this_thread) {
+#if HAVE_INTEL_TBB
+            MADNESS_EXCEPTION("run_tasks_stealing should not be called when using Intel TBB", 1);
+#else
+            PoolTaskInterface* taskbuf[nmax];
+            int ntask = 0;
+            if (!queue.empty())
+                ntask = queue.pop_front(nmax, taskbuf, false);
+            if (ntask == 0 && this_thread && this_thread->deque_ &&
+                this_thread->deque_->pop(taskbuf[0]))
+                ntask = 1;
+            if (ntask == 0 && steal_task(this_thread, taskbuf[0]))
+                ntask = 1;
+
+            if (ntask == 0) {
+                if (wait) idle_wait();
+                return false;
             }
-            return t.second;
+            execute_tasks(ntask, taskbuf, this_thread);
+            return true;
+#endif
+        }
+
+        /// Run tasks using the NUMA policy.
+
+        /// Tasks are taken from the queue of this thread's domain, then
+        /// from the shared queue, and only if both are empty one task is
+        /// taken from another domain. Threads outside the pool have no
+        /// domain and look at the shared queue first.
+        /// \param[in] wait If true, back off when no work was found.
+        /// \param[in,out] this_thread The calling pool thread or \c nullptr.
+        /// \return True if any task was run.
+        bool run_tasks_numa(bool wait, ThreadPoolThread* const this_thread) {
+#if HAVE_INTEL_TBB
+            MADNESS_EXCEPTION("run_tasks_numa should not be called when using Intel TBB", 1);
+#else
+            PoolTaskInterface* taskbuf[nmax];
+            int ntask = 0;
+            const int mine = this_thread ? this_thread->domain_ : -1;
+            if (mine >= 0 && domain_queues[mine]->size())
+                ntask = domain_queues[mine]->pop_front(nmax, taskbuf, false);
+            if (ntask == 0 && !queue.empty())
+                ntask = queue.pop_front(nmax, taskbuf, false);
+            for (int i=1; ntask==0 && i<=ndomains; ++i) {
+                const int d = (mine + i + ndomains) % ndomains;
+                if (d != mine && domain_queues[d]->size()) {
+                    ntask = domain_queues[d]->pop_front(1, taskbuf, false);
+                    if (ntask && mine >= 0)
+                        ndomain_steals.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            if (ntask == 0) {
+                if (wait) idle_wait();
+                return false;
+            }
+            execute_tasks(ntask, taskbuf, this_thread);
+            return true;
 #endif
         }
 
@@ -1235,6 +1526,10 @@ namespace madness {
 
             MADNESS_EXCEPTION("run_tasks should not be called when using Intel TBB", 1);
 #else
+            if (policy == SchedulerPolicy::WorkStealing)
+                return run_tasks_stealing(wait, this_thread);
+            if (policy == SchedulerPolicy::NUMA)
+                return run_tasks_numa(wait, this_thread);
 
             PoolTaskInterface* taskbuf[nmax];
             int ntask = queue.pop_front(nmax, taskbuf, wait);
@@ -1336,14 +1631,36 @@ namespace madness {
                 tbb::task::enqueue(*task);
 #else
             if (!task) MADNESS_EXCEPTION("ThreadPool: inserting a NULL task pointer", 1);
+            ThreadPool* const pool = instance();
             int task_threads = task->get_nthread();
+            // When work stealing, ordinary tasks spawned by a pool thread
+            // stay local; everything else goes through the shared queue
+            if (pool->policy == SchedulerPolicy::WorkStealing &&
+                task_threads == 1 && !task->is_high_priority()) {
+                ThreadPoolThread* const thread = this_pool_thread();
+                if (thread) {
+                    thread->deque_->push(task);
+                    return;
+                }
+            }
+            // With the NUMA policy hinted tasks go to their domain's queue
+            if (pool->policy == SchedulerPolicy::NUMA &&
+                task_threads == 1 && task->has_affinity_hint()) {
+                DQueue<PoolTaskInterface*>& q =
+                    *(pool->domain_queues[task->get_affinity_hint() % pool->ndomains]);
+                if (task->is_high_priority())
+                    q.push_front(task);
+                else
+                    q.push_back(task);
+                return;
+            }
             // Currently multithreaded tasks must be shoved on the end of the q
             // to avoid a race condition as multithreaded task is starting up
             if (task->is_high_priority() && (task_threads == 1)) {
-                instance()->queue.push_front(task);
+                pool->queue.push_front(task);
             }
             else {
-                instance()->queue.push_back(task, task_threads);
+                pool->queue.push_back(task, task_threads);
             }
 #endif // HAVE_INTEL_TBB
         }
@@ -1358,6 +1675,45 @@ namespace madness {
             queue.scan(op);
         }
 
+        /// Add several tasks to the pool at once.
+
+        /// Ordinary tasks bound for the shared queue are pushed with a
+        /// single lock acquisition; high-priority, multi-threaded and
+        /// tasks routed elsewhere by the scheduler policy are added one
+        /// at a time as by \c add(PoolTaskInterface*). The relative order
+        /// of the tasks is preserved.
+        /// \param[in] tasks Pointer to the first of the tasks.
+        /// \param[in] ntask The number of tasks.
+        static void add(PoolTaskInterface* const* tasks, std::size_t ntask) {
+#if HAVE_INTEL_TBB || HAVE_PARSEC
+            for (std::size_t i=0; i<ntask; ++i)
+                add(tasks[i]);
+#else
+            ThreadPool* const pool = instance();
+            const bool local = (pool->policy == SchedulerPolicy::WorkStealing) &&
+                this_pool_thread();
+            std::size_t start = 0; // First task of the current run for the shared queue
+            for (std::size_t i=0; i<ntask; ++i) {
+                PoolTaskInterface* const task = tasks[i];
+                if (!task) MADNESS_EXCEPTION("ThreadPool: inserting a NULL task pointer", 1);
+                const bool shared = !local && task->get_nthread() == 1 &&
+                    !task->is_high_priority() &&
+                    !(pool->policy == SchedulerPolicy::NUMA && task->has_affinity_hint());
+                if (shared) {
+#ifdef MADNESS_TASK_PROFILING
+                    task->submit();
+#endif // MADNESS_TASK_PROFILING
+                }
+                else {
+                    if (i > start) pool->queue.push_back(tasks+start, i-start);
+                    add(task);
+                    start = i+1;
+                }
+            }
+            if (ntask > start) pool->queue.push_back(tasks+start, ntask-start);
+#endif
+        }
+
         /// Add a vector of tasks to the pool.
 
         /// \param[in] tasks Vector of tasks to add to the pool.
@@ -1365,10 +1721,7 @@ namespace madness {
 #if HAVE_INTEL_TBB
             MADNESS_EXCEPTION("Do not add tasks to the madness task queue when using Intel TBB.", 1);
 #else
-            typedef std::vector<PoolTaskInterface*>::const_iterator iteratorT;
-            for (iteratorT it=tasks.begin(); it!=tasks.end(); ++it) {
-                add(*it);
-            }
+            add(tasks.data(), tasks.size());
 #endif
         }
 
@@ -1397,7 +1750,8 @@ namespace madness {
 #ifdef MADNESS_TASK_PROFILING
             ThreadPoolThread* const thread = static_cast<ThreadPoolThread*>(ThreadBase::this_thread());
 #else
-            ThreadPoolThread* const thread = nullptr;
+            ThreadPoolThread* const thread =
+                (instance()->policy != SchedulerPolicy::Queue) ? this_pool_thread() : nullptr;
 #endif // MADNESS_TASK_PROFILING
 
             return instance()->run_tasks(false, thread);
@@ -1415,14 +1769,55 @@ namespace madness {
 
         /// \return The number of tasks in the queue.
         static std::size_t queue_size() {
-            return instance()->queue.size();
+            ThreadPool* const pool = instance();
+            std::size_t n = pool->queue.size();
+            if (pool->policy == SchedulerPolicy::WorkStealing) {
+                for (int i=0; i<pool->nthreads; ++i)
+                    n += pool->threads[i].deque_->size();
+            }
+            for (const auto& q : pool->domain_queues)
+                n += q->size();
+            return n;
         }
 
         /// Returns queue statistics.
 
+        /// When work stealing these describe only the shared injection queue.
         /// \return Queue statistics.
         static const DQStats& get_stats();
 
+        /// Returns the scheduler policy in use.
+
+        /// \return The scheduler policy.
+        static SchedulerPolicy scheduler_policy() {
+            return instance()->policy;
+        }
+
+        /// Returns work-stealing statistics summed over the pool threads.
+
+        /// \return All zero unless the scheduler policy is \c SchedulerPolicy::WorkStealing.
+        static WSDequeStats get_ws_stats();
+
+        /// Returns statistics summed over the per-domain queues.
+
+        /// \c nmax is the largest of the per-domain values.
+        /// \return All zero unless the scheduler policy is \c SchedulerPolicy::NUMA.
+        static DQStats get_domain_stats();
+
+        /// Returns the number of tasks a pool thread took from another domain.
+
+        /// \return Zero unless the scheduler policy is \c SchedulerPolicy::NUMA.
+        static std::uint64_t get_domain_steals() {
+            return instance()->ndomain_steals.load(std::memory_order_relaxed);
+        }
+
+        /// Returns the number of NUMA domains used by the pool.
+
+        /// \return One unless the scheduler policy is \c SchedulerPolicy::NUMA.
+        static int num_domains() {
+            return instance()->ndomains;
+        }
+
         /// Access the pool thread array
         /// \return ptr to the pool thread array, its size is given by \c size()
         static const ThreadPoolThread* get_threads() {
@@ -1432,16 +1827,24 @@ namespace madness {
         /// Gracefully wait for a condition to become true, executing any tasks in the queue.
 
         /// Probe should be an object that, when called, returns the status.
-        /// \todo Descriptions needed/need verification.
+        ///
+        /// When there is no work the thread waits according to the policy
+        /// set by \c threadpool_wait_policy. With \c WaitPolicy::Adaptive it
+        /// spins, then yields, and then parks until \c notify_waiters() is
+        /// called (by \c Future assignment, task completion and RMI message
+        /// arrival) or the park duration expires, so probes that nobody
+        /// notifies about (e.g., MPI requests) are still polled.
         /// \tparam Probe Type of the probe.
         /// \param[in] probe The probe.
         /// \param[in] dowork Do work while waiting - default is true
         /// \param[in] sleep Sleep instead of spin while waiting (e.g., to avoid pounding on MPI) - default is false
         template <typename Probe>
-	  static void await(const Probe& probe, bool dowork = true, bool sleep = false) {
+        static void await(const Probe& probe, bool dowork = true, bool sleep = false) {
             double start = cpu_time();
             const double timeout = await_timeout;
             int counter = 0;
+            int nidle = 0; // #consecutive probes that found no work
+            double idle = 0.0;
 
             MutexWaiter waiter;
             while (!probe()) {
@@ -1451,9 +1854,12 @@ namespace madness {
 
                 if (working) {	// Reset timeout logic
                     waiter.reset();
+                    if (nidle) idle += current_time - start;
+                    nidle = 0;
                     start = current_time;
                     counter = 0;
                 } else {
+                    if (nidle++ == 0) await_nidle.fetch_add(1, std::memory_order_relaxed);
                     if(((current_time - start) > timeout) && (timeout > 1.0)) { // Check for timeout
                       std::cerr << "!!MADNESS: Hung queue?" << std::endl;
                       if (counter++ > 3) {
@@ -1464,31 +1870,60 @@ namespace madness {
                                                         __FILE__);
                       }
                     }
-		    if (sleep) {
-		      // THIS NEEDS TO BECOME AN EXTERNAL PARAMETER
-		      // Problem is exacerbated when running with many
-		      // (e.g., 512 or more) send/recv buffers, and
-		      // also with many threads.  More outstanding
-		      // requests means each call into MPI takes
-		      // longer and more threads means more calls in
-		      // spots where all threads are messaging.  Old
-		      // code was OK on dancer.icl.utk.edu with just
-		      // 32 bufs and 20 threads, but 512 bufs caused
-		      // intermittent hangs I think due to something
-		      // not being able to make progress or general
-		      // confusion (this with MPICH) ... maybe using a
-		      // fair mutex somewhere would help.
-		      //
-		      // 100us is a long time ... will try 10us. mmm ... perhaps need 100 at least on dancer with 17 threads per node
-		      myusleep(100);
-		    }
-		    else {
-		      waiter.wait();
-		    }
+                    if (await_policy == WaitPolicy::Adaptive) {
+                        // Spin for 20us, yield until 100us, then park.
+                        // Spinning on MPI requests slows MPI down, so skip
+                        // straight to yielding.  Without pool threads nobody
+                        // else runs tasks, so never park.
+                        const double idle_for = current_time - start;
+                        if (idle_for < 20e-6 && !sleep)
+                            waiter.wait();
+                        else if (idle_for < 100e-6 || (dowork && size() == 0))
+                            std::this_thread::yield();
+                        else
+                            park(probe);
+                    }
+                    else if (sleep || await_policy == WaitPolicy::Sleep) {
+                        // Problem is exacerbated when running with many
+                        // (e.g., 512 or more) send/recv buffers, and
+                        // also with many threads.  More outstanding
+                        // requests means each call into MPI takes
+                        // longer and more threads means more calls in
+                        // spots where all threads are messaging.  The
+                        // default of 100us was needed on dancer with
+                        // 17 threads per node.
+                        myusleep(await_usleep);
+                    }
+                    else if (await_policy == WaitPolicy::Yield) {
+                        std::this_thread::yield();
+                    }
+                    else {
+                        waiter.wait();
+                    }
                 }
             }
+            if (nidle) idle += cpu_time() - start;
+            if (idle > 0.0)
+                await_idle_ns.fetch_add(std::uint64_t(idle*1e9), std::memory_order_relaxed);
         }
 
+        /// Wake the threads parked in \c await so they check their probes.
+
+        /// Call this after changing state that a probe may be waiting on.
+        /// It costs a memory fence when the wait policy is
+        /// \c WaitPolicy::Adaptive and nothing otherwise.
+        static void notify_waiters() {
+            if (await_policy != WaitPolicy::Adaptive) return;
+            // Pairs with the increment of nparked in park()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (nparked.load(std::memory_order_relaxed) > 0) wake_waiters();
+        }
+
+        /// Returns statistics of the threads waiting in \c await.
+
+        /// \return The statistics, accumulated since the start of the program.
+        static AwaitStats get_await_stats();
+
         /// Destructor.
         ~ThreadPool() {
 #if HAVE_PARSEC
@@ -1509,20 +1944,27 @@ namespace madness {
 #if !HAVE_INTEL_TBB && !HAVE_PARSEC
           instance()->queue.set_wait_policy(policy,
                                             sleep_duration_in_microseconds);
+          instance()->idle_policy = policy;
+          instance()->idle_usleep = sleep_duration_in_microseconds;
 #endif
+          await_policy = policy;
+          if (sleep_duration_in_microseconds > 0)
+              await_usleep = sleep_duration_in_microseconds;
         }
 
     };
 
     // clang-format off
     /// Controls how aggressively ThreadPool holds on to the OS threads
-    /// while waiting for work. Currently useful only for Pthread pool when it's using spinlocks;
-    /// NOT used for TBB or PaRSEC.
+    /// while waiting for work. For the pool threads this is currently useful only for Pthread pool when it's using spinlocks;
+    /// NOT used for TBB or PaRSEC. It also controls how threads blocked in ThreadPool::await (fences, Future::get()) wait.
     /// \param policy specifies how to wait for work;
     ///        - WaitPolicy::Busy -- threads are kept busy (default); recommended when intensive work is only performed by MADNESS threads
     ///        - WaitPolicy::Yield -- thread yields; recommended when intensive work is performed primarily by non-MADNESS threads
     ///        - WaitPolicy::Sleep -- thread sleeps for \p sleep_duration_in_microseconds ; recommended when intensive work is performed by MADNESS nd non-MADNESS threads
-    /// \param sleep_duration_in_microseconds if `policy==WaitPolicy::Sleep` this specifies the duration of sleep, in microseconds
+    ///        - WaitPolicy::Adaptive -- thread spins, then yields, then threads in ThreadPool::await park until woken by a future being set, a task completing or an RMI message arriving; recommended when waiting threads should not burn a core
+    /// \param sleep_duration_in_microseconds if `policy==WaitPolicy::Sleep` this specifies the duration of sleep, in microseconds;
+    ///        if `policy==WaitPolicy::Adaptive` it bounds how long a thread stays parked without a wake-up (default 100)
     // clang-format on
     inline void threadpool_wait_policy(WaitPolicy policy,
                                        int sleep_duration_in_microseconds = 0) {
@@ -264,6 +264,9 @@ namespace madness {
         double total_cpu_time = cpu_time()-start_cpu_time;
         RMIStats rmi = RMI::get_stats();
         DQStats q = ThreadPool::get_stats();
+        WSDequeStats ws = ThreadPool::get_ws_stats();
+        DQStats dq = ThreadPool::get_domain_stats();
+        AwaitStats aw = ThreadPool::get_await_stats();
 #ifdef HAVE_PAPI
         // For papi ... this only make sense if done once after all
         // other worker threads have exited
@@ -304,10 +307,38 @@ namespace madness {
         world.gop.min(min_nbyte_recv);
         world.gop.min(min_server_q);
 
+        // Load balance among RMI servers ... incoming messages per server
+        const int nserver = RMI::nserver();
+        double min_serv_recv = 0.0, max_serv_recv = 0.0;
+        for (int i=0; i<nserver; ++i) {
+            const double n = RMI::get_stats(i).nmsg_recv;
+            min_serv_recv = (i == 0) ? n : std::min(min_serv_recv, n);
+            max_serv_recv = std::max(max_serv_recv, n);
+        }
+        world.gop.min(min_serv_recv);
+        world.gop.max(max_serv_recv);
+
+        AmSendStats amsend = world.am.get_send_stats();
+        double nsend_slot = amsend.nsend, min_nsend_slot = amsend.nsend, max_nsend_slot = amsend.nsend;
+        double nsend_stall = amsend.nstall, min_nsend_stall = amsend.nstall, max_nsend_stall = amsend.nstall;
+        double send_stall_time = amsend.stall_time;
+        world.gop.sum(nsend_slot);
+        world.gop.min(min_nsend_slot);
+        world.gop.max(max_nsend_slot);
+        world.gop.sum(nsend_stall);
+        world.gop.min(min_nsend_stall);
+        world.gop.max(max_nsend_stall);
+        world.gop.sum(send_stall_time);
+
+        double nagg_msg = world.am.get_naggregated();
+        double nagg_send = world.am.get_naggregate_sends();
+        world.gop.sum(nagg_msg);
+        world.gop.sum(nagg_send);
+
         double npush_back = q.npush_back;
         double npush_front = q.npush_front;
         double npop_front = q.npop_front;
-        double ntask = q.npush_back + q.npush_front;
+        double ntask = q.npush_back + q.npush_front + ws.npush + dq.npush_back + dq.npush_front;
         double nmax = q.nmax;
         world.gop.sum(npush_back);
         world.gop.sum(npush_front);
@@ -318,7 +349,7 @@ namespace madness {
         double max_npush_back = q.npush_back;
         double max_npush_front = q.npush_front;
         double max_npop_front = q.npop_front;
-        double max_ntask = q.npush_back + q.npush_front;
+        double max_ntask = q.npush_back + q.npush_front + ws.npush + dq.npush_back + dq.npush_front;
         double max_nmax = q.nmax;
         world.gop.max(max_npush_back);
         world.gop.max(max_npush_front);
@@ -329,7 +360,7 @@ namespace madness {
         double min_npush_back = q.npush_back;
         double min_npush_front = q.npush_front;
         double min_npop_front = q.npop_front;
-        double min_ntask = q.npush_back + q.npush_front;
+        double min_ntask = q.npush_back + q.npush_front + ws.npush + dq.npush_back + dq.npush_front;
         double min_nmax = q.nmax;
         world.gop.min(min_npush_back);
         world.gop.min(min_npush_front);
@@ -337,6 +368,50 @@ namespace madness {
         world.gop.min(min_ntask);
         world.gop.min(min_nmax);
 
+        const bool stealing = (ThreadPool::scheduler_policy() == SchedulerPolicy::WorkStealing);
+        double nlocal = ws.npush;
+        double nsteal = ws.nsteal;
+        double max_nlocal = nlocal, min_nlocal = nlocal;
+        double max_nsteal = nsteal, min_nsteal = nsteal;
+        if (stealing) {
+            world.gop.sum(nlocal);
+            world.gop.sum(nsteal);
+            world.gop.max(max_nlocal);
+            world.gop.max(max_nsteal);
+            world.gop.min(min_nlocal);
+            world.gop.min(min_nsteal);
+        }
+
+        double idle_time = aw.idle_time;
+        double npark = aw.npark;
+        double wakeup = (aw.nwakeup ? aw.wakeup_latency/aw.nwakeup : 0.0);
+        double max_idle_time = idle_time, min_idle_time = idle_time;
+        double max_npark = npark, min_npark = npark;
+        double max_wakeup = aw.max_wakeup_latency, min_wakeup = wakeup;
+        world.gop.sum(idle_time);
+        world.gop.sum(npark);
+        world.gop.sum(wakeup);
+        world.gop.max(max_idle_time);
+        world.gop.max(max_npark);
+        world.gop.max(max_wakeup);
+        world.gop.min(min_idle_time);
+        world.gop.min(min_npark);
+        world.gop.min(min_wakeup);
+
+        const bool numa = (ThreadPool::scheduler_policy() == SchedulerPolicy::NUMA);
+        double nhinted = dq.npush_back + dq.npush_front;
+        double nremote = ThreadPool::get_domain_steals();
+        double max_nhinted = nhinted, min_nhinted = nhinted;
+        double max_nremote = nremote, min_nremote = nremote;
+        if (numa) {
+            world.gop.sum(nhinted);
+            world.gop.sum(nremote);
+            world.gop.max(max_nhinted);
+            world.gop.max(max_nremote);
+            world.gop.min(min_nhinted);
+            world.gop.min(min_nremote);
+        }
+
 #ifdef HAVE_PAPI
         double val[NUMEVENTS], max_val[NUMEVENTS], min_val[NUMEVENTS];
         for (int i=0; i<NUMEVENTS; ++i) {
@@ -357,8 +432,13 @@ namespace madness {
                 printf("          #total threads    %d\n", int(ThreadPool::size()+1));
             }
             else {
-                printf("       #threads per node    %d+main+server = %d\n", int(ThreadPool::size()), int(ThreadPool::size()+2));
-                printf("          #total threads    %d\n", int(ThreadPool::size()+2)*world.size());
+                if (nserver > 1) {
+                    printf("       #threads per node    %d+main+%d servers = %d\n", int(ThreadPool::size()), nserver, int(ThreadPool::size()+1+nserver));
+                }
+                else {
+                    printf("       #threads per node    %d+main+server = %d\n", int(ThreadPool::size()), int(ThreadPool::size()+2));
+                }
+                printf("          #total threads    %d\n", int(ThreadPool::size()+1+std::max(nserver,1))*world.size());
             }
             printf("\n");
 
@@ -376,6 +456,21 @@ namespace madness {
                    min_nbyte_recv, nbyte_recv/world.size(), max_nbyte_recv);
             printf("        #msgs systemwide    %.2e\n", nmsg_sent);
             printf("       #bytes systemwide    %.2e\n", nbyte_sent);
+            if (nserver > 1) {
+                printf("   #msgs recv per server    %.2e / %.2e / %.2e\n",
+                       min_serv_recv, nmsg_recv/(world.size()*nserver), max_serv_recv);
+            }
+            printf(" #AM send slots per node    %.2e / %.2e / %.2e\n",
+                   min_nsend_slot, nsend_slot/world.size(), max_nsend_slot);
+            printf("#AM send stalls per node    %.2e / %.2e / %.2e\n",
+                   min_nsend_stall, nsend_stall/world.size(), max_nsend_stall);
+            if (nsend_stall > 0) {
+                printf("  AM stall time (s)/node    %.2e\n", send_stall_time/world.size());
+            }
+            if (nagg_send > 0) {
+                printf(" #aggregated AM per node    %.2e in %.2e messages\n",
+                       nagg_msg/world.size(), nagg_send/world.size());
+            }
             printf("\n");
             printf("  Thread pool statistics (min / avg / max)\n");
             printf("  ----------------------\n");
@@ -385,6 +480,26 @@ namespace madness {
                    min_nmax, nmax/world.size(), max_nmax);
             printf("  #hi-pri tasks per node    %.2e / %.2e / %.2e\n",
                    min_npush_front, npush_front/world.size(), max_npush_front);
+            if (stealing) {
+                printf("   #local tasks per node    %.2e / %.2e / %.2e\n",
+                       min_nlocal, nlocal/world.size(), max_nlocal);
+                printf("  #stolen tasks per node    %.2e / %.2e / %.2e\n",
+                       min_nsteal, nsteal/world.size(), max_nsteal);
+            }
+            printf(" await idle (s) per node    %.2e / %.2e / %.2e\n",
+                   min_idle_time, idle_time/world.size(), max_idle_time);
+            if (npark > 0) {
+                printf("  #parked waits per node    %.2e / %.2e / %.2e\n",
+                       min_npark, npark/world.size(), max_npark);
+                printf("      wakeup latency (s)    %.2e / %.2e / %.2e\n",
+                       min_wakeup, wakeup/world.size(), max_wakeup);
+            }
+            if (numa) {
+                printf("  #hinted tasks per node    %.2e / %.2e / %.2e\n",
+                       min_nhinted, nhinted/world.size(), max_nhinted);
+                printf("#cross-domain tasks/node    %.2e / %.2e / %.2e\n",
+                       min_nremote, nremote/world.size(), max_nremote);
+            }
             printf("\n");
 #ifdef HAVE_PAPI
             printf("         PAPI statistics (min / avg / max)\n");
@@ -477,7 +477,7 @@ namespace madness {
 	/// \param sleep Sleep instead of spin while waiting - default is false
         template <typename Probe>
 	  static void inline await(const Probe& probe, bool dowork = true, bool sleep=false) {
-            ThreadPool::await(probe, dowork);
+            ThreadPool::await(probe, dowork, sleep);
         }
 
         /// Crude seed function for random number generation.
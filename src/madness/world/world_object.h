@@ -564,7 +564,7 @@ namespace madness {
             else {
                 detail::info<memfnT> info(objid, me, memfn, result.remote_ref(world));
                 world.am.send(dest, & objT::template handler<memfnT, a1T, a2T, a3T, a4T, a5T, a6T, a7T, a8T, a9T>,
-                        new_am_arg(info, a1, a2, a3, a4, a5, a6, a7, a8, a9));
+                        new_am_arg_bulk(info, a1, a2, a3, a4, a5, a6, a7, a8, a9));
             }
 
             return result;
@@ -610,7 +610,7 @@ namespace madness {
             typename taskT::futureT result;
             detail::info<memfnT> info(objid, me, memfn, result.remote_ref(world), attr);
             world.am.send(dest, & objT::template spawn_remote_task_handler<taskT>,
-                    new_am_arg(info, a1, a2, a3, a4, a5, a6, a7, a8, a9));
+                    new_am_arg_bulk(info, a1, a2, a3, a4, a5, a6, a7, a8, a9));
 
             return result;
         }
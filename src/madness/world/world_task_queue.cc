@@ -57,4 +57,29 @@ namespace madness {
         nregistered = 0;
     }
 
+    thread_local WorldTaskQueue::Batch* WorldTaskQueue::Batch::current = nullptr;
+    thread_local std::vector<TaskInterface*> WorldTaskQueue::Batch::tasks;
+
+    void WorldTaskQueue::add_batch(TaskInterface* const* tasks, std::size_t ntask) {
+        if (ntask == 0) return;
+        nregistered += int(ntask);
+
+        // Ready tasks are passed on in chunks so no allocation is needed
+        const std::size_t NREADY = 64;
+        PoolTaskInterface* ready[NREADY];
+        std::size_t nready = 0;
+        for (std::size_t i=0; i<ntask; ++i) {
+            TaskInterface* const t = tasks[i];
+            t->set_info(&world, this);
+            if (t->register_or_claim_final_callback(&t->submit)) {
+                ready[nready++] = t;
+                if (nready == NREADY) {
+                    ThreadPool::add(ready, nready);
+                    nready = 0;
+                }
+            }
+        }
+        if (nready) ThreadPool::add(ready, nready);
+    }
+
 }  // namespace madness
@@ -40,6 +40,7 @@
 
 #include <type_traits>
 #include <iostream>
+#include <vector>
 #include <madness/world/meta.h>
 #include <madness/world/nodefaults.h>
 #include <madness/world/range.h>
@@ -321,7 +322,7 @@ namespace madness {
 
         /// \todo Brief description needed.
         void notify() {
-            nregistered--;
+            if (nregistered.dec_and_test()) ThreadPool::notify_waiters(); // A fence may be waiting
         }
 
         /// \todo Brief description needed.
@@ -460,6 +461,12 @@ namespace madness {
         /// tasks and be deleted.
         /// \param[in] t Pointer to the task.
         void add(TaskInterface* t)  {
+            Batch* const batch = Batch::current;
+            if (batch && batch->taskq == this) {
+                Batch::tasks.push_back(t);
+                return;
+            }
+
             nregistered++;
 
             t->set_info(&world, this);       // Stuff info
@@ -468,6 +475,65 @@ namespace madness {
             t->register_submit_callback();
         }
 
+        /// Add several new local tasks at once, taking ownership of the pointers.
+
+        /// Equivalent to calling \c add() on each task except that the
+        /// count of pending tasks is updated once and the tasks whose
+        /// dependencies are already satisfied are handed to the thread pool
+        /// together (see \c ThreadPool::add(PoolTaskInterface* const*, std::size_t)).
+        /// Tasks still waiting on futures are submitted when those are set,
+        /// as usual.
+        /// \param[in] tasks Pointer to the first of the tasks.
+        /// \param[in] ntask The number of tasks.
+        void add_batch(TaskInterface* const* tasks, std::size_t ntask);
+
+        /// Add a vector of new local tasks at once, taking ownership of the pointers.
+
+        /// \param[in] tasks The tasks.
+        void add_batch(const std::vector<TaskInterface*>& tasks) {
+            add_batch(tasks.data(), tasks.size());
+        }
+
+        /// Collects the tasks a thread adds to a queue and submits them together.
+
+        /// While a \c Batch is in scope, tasks that the constructing thread
+        /// adds to the queue are held back and given to \c add_batch() when
+        /// the \c Batch is destroyed. Loops that spawn the children of a
+        /// node use this so that 2^NDIM children cost one update of the task
+        /// counter and one lock of the thread pool queue. Only the outermost
+        /// \c Batch of a thread has any effect.
+        ///
+        /// \attention Do not wait on the result of a task added in the scope
+        ///     of a \c Batch; the task is not submitted until the scope ends.
+        class Batch : private NO_DEFAULTS {
+            friend class WorldTaskQueue;
+
+            WorldTaskQueue* const taskq; ///< The queue, null if this is not the outermost batch.
+            static thread_local Batch* current; ///< The outermost batch of this thread.
+            static thread_local std::vector<TaskInterface*> tasks; ///< Held back tasks, storage is reused.
+
+        public:
+            /// Start collecting the tasks this thread adds to \c q.
+
+            /// \param[in,out] q The task queue.
+            explicit Batch(WorldTaskQueue& q) : taskq(current ? nullptr : &q) {
+                if (taskq) current = this;
+            }
+
+            /// Submit the collected tasks.
+            ~Batch() {
+                if (taskq) {
+                    current = nullptr;
+                    // Submitting may run callbacks that start another batch
+                    std::vector<TaskInterface*> mine;
+                    mine.swap(tasks);
+                    taskq->add_batch(mine);
+                    mine.clear();
+                    tasks.swap(mine);
+                }
+            }
+        };
+
         /// \todo Brief description needed.
 
         /// \todo Descriptions needed.
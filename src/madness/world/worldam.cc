@@ -33,22 +33,67 @@
 #include <madness/world/MADworld.h>
 #include <madness/world/worldmpi.h>
 #include <sstream>
+#include <algorithm>
 
 namespace madness {
 
+    double WorldAmInterface::agg_timeout = 100e-6;
+
+    namespace {
+        // Instances that aggregate, for the RMI poll hook.  The server
+        // only ever try_locks the mutex so that it never blocks.
+        Mutex aggregators_mutex;
+        std::vector<WorldAmInterface*> aggregators;
+    }
+
+    void detail::fetch_am_bulk(const void* owner, unsigned long tag, void* p, std::size_t nbyte) {
+        const AmArg* arg = static_cast<const AmArg*>(owner);
+        World* world = arg->get_world();
+        MADNESS_ASSERT(world);
+        RMI::bulk_recv(p, nbyte, world->am.map_to_comm_world[arg->get_src()], int(tag));
+    }
+
+    void WorldAmInterface::flush_expired_all() {
+        if (aggregators_mutex.try_lock()) {
+            for (WorldAmInterface* am : aggregators) am->flush_expired();
+            aggregators_mutex.unlock();
+        }
+    }
+
+    void WorldAmInterface::set_aggregation(std::size_t nbyte) {
+        fence();
+        if (nbyte) {
+            nbyte = std::max(nbyte, std::size_t(1024));
+            if (!agg_buf) {
+                agg_buf.reset(new AggregateBuffer[nproc]);
+                ScopedMutex<Mutex> guard(aggregators_mutex);
+                aggregators.push_back(this);
+                RMI::set_poll_hook(flush_expired_all);
+            }
+        }
+        agg_max_msg = nbyte/8;
+        agg_nbyte = nbyte;
+    }
+
 
 
     WorldAmInterface::WorldAmInterface(World& world)
             : nsend(DEFAULT_NSEND)
-            , send_req(nullptr)
+            , nsend_max(DEFAULT_NSEND_MAX)
             , worldid(0) // worldid is initialized in the World constructor
             , rank(world.mpi.Get_rank())
             , nproc(world.mpi.Get_size())
-            , cur_msg(0)
             , nsent(0)
             , nrecv(0)
             , map_to_comm_world(nproc)
+            , agg_nbyte(0)
+            , agg_max_msg(0)
+            , agg_buf(nullptr)
+            , nagg_msg(0)
+            , nagg_send(0)
     {
+        agg_npending = 0;
+
         lock();
 
         // Initialize the number of send buffers
@@ -64,10 +109,19 @@ namespace madness {
             }
         }
 
-        // Allocate send buffers and requests
-        send_req.reset(new SendReq[nsend]);
+        // Upper limit to which the send buffers may grow
+        const char* mad_send_buffs_max = getenv("MAD_SEND_BUFFERS_MAX");
+        if(mad_send_buffs_max) {
+            std::stringstream ss(mad_send_buffs_max);
+            ss >> nsend_max;
+        }
+        nsend_max = std::max(nsend_max, nsend);
 
-        for (int i=0; i<nsend; ++i) send_req[i].set((AmArg*) 0,RMI::Request());
+        // Allocate send requests and buffers, with the lowest slots used first
+        send_req.resize(nsend);
+        send_buf.resize(nsend, nullptr);
+        for (int i=nsend-1; i>=0; --i) send_free.push_back(i);
+        send_stats.nsend = nsend;
 
         std::vector<int> fred(nproc);
         for (int i=0; i<nproc; ++i) fred[i] = i;
@@ -80,13 +134,35 @@ namespace madness {
         // }
 
         unlock();
+
+        // Optionally aggregate small messages
+        const char* mad_aggregate = getenv("MAD_AM_AGGREGATE");
+        if (mad_aggregate) {
+            std::stringstream ss(mad_aggregate);
+            std::size_t nbyte = 0;
+            ss >> nbyte;
+            const char* mad_timeout = getenv("MAD_AM_AGGREGATE_TIMEOUT");
+            if (mad_timeout) {
+                std::stringstream st(mad_timeout);
+                double us = 0.0;
+                st >> us;
+                if (us > 0.0) agg_timeout = 1e-6*us;
+            }
+            set_aggregation(nbyte);
+        }
     }
 
     WorldAmInterface::~WorldAmInterface() {
+        if (agg_buf) {
+            ScopedMutex<Mutex> guard(aggregators_mutex);
+            aggregators.erase(std::find(aggregators.begin(), aggregators.end(), this));
+        }
         if(!SafeMPI::Is_finalized()) {
+            fence();
             while (free_managed_buffers() != nsend) myusleep(100);
         }
-        // otherwise the send buffers are freed when the WorldAMInterface::send_req is freed
+        // otherwise free the buffers of sends that MPI will never complete
+        for (AmArg* buf : send_buf) if (buf) free_am_arg(buf);
     }
 
 } // namespace madness
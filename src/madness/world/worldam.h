@@ -38,9 +38,12 @@
 #include <madness/world/buffer_archive.h>
 #include <madness/world/worldrmi.h>
 #include <madness/world/world.h>
+#include <madness/world/pool_alloc.h>
+#include <algorithm>
 #include <vector>
 #include <cstddef>
 #include <memory>
+#include <atomic>
 #include <pthread.h>
 
 namespace madness {
@@ -76,6 +79,26 @@ namespace madness {
     /// Type of AM handler functions
     typedef void (*am_handlerT)(const AmArg&);
 
+    namespace detail {
+
+        /// A block of data that travels beside an active message (see new_am_arg_bulk)
+        struct AmBulk {
+            const void* ptr;                    ///< The data
+            std::size_t nbyte;                  ///< Size of the data
+            int tag;                            ///< Tag it is sent with
+            std::shared_ptr<const void> keeper; ///< Keeps the data alive until it is sent
+        };
+
+        typedef std::vector<AmBulk> AmBulkList;
+
+        /// Receives a block of an incoming message ... a BufferInputArchive::fetchT whose owner is the AmArg
+        void fetch_am_bulk(const void* owner, unsigned long tag, void* p, std::size_t nbyte);
+
+        template <typename... argT>
+        AmArg* serialize_new_am_arg(std::size_t bulk_min, const argT&... args);
+
+    } // namespace detail
+
     /// World active message that extends an RMI message
     class AmArg {
     private:
@@ -83,6 +106,7 @@ namespace madness {
         template <class Derived> friend class WorldObject;
 
         friend AmArg* alloc_am_arg(std::size_t nbyte);
+        template <typename... argT> friend AmArg* detail::serialize_new_am_arg(std::size_t bulk_min, const argT&... args);
 
         unsigned char header[RMI::HEADER_LEN]; // !!!!!!!!!  MUST BE FIRST !!!!!!!!!!
         std::size_t nbyte;      // Size of user payload
@@ -113,11 +137,17 @@ namespace madness {
 
         bool is_pending() const { return flags & 0x1ul; }
 
-        void clear_flags() { flags = 0; }
+        /// Marks a message whose large blocks may travel beside it, which changes its layout
+        void set_bulk() { flags |= 0x2ul; }
+
+        bool is_bulk() const { return flags & 0x2ul; }
+
+        void clear_flags() { flags &= 0x2ul; } // The layout stays
 
         am_handlerT get_func() const { return archive::to_abs_fn_ptr<am_handlerT>(func); }
 
         archive::BufferInputArchive make_input_arch() const {
+            if (is_bulk()) return archive::BufferInputArchive(buf(),size(),detail::fetch_am_bulk,this);
             return archive::BufferInputArchive(buf(),size());
         }
 
@@ -126,7 +156,7 @@ namespace madness {
         }
 
     public:
-        AmArg() {}
+        AmArg() : flags(0) {}
 
         /// Returns a pointer to the user's payload (aligned in same way as AmArg)
         unsigned char* buf() const { return (unsigned char*)(this) + sizeof(AmArg); }
@@ -158,11 +188,33 @@ namespace madness {
     };
 
 
+    /// Space in front of an AmArg from alloc_am_arg that records the size allocated
+
+    /// The payload size of a message may shrink after allocation
+    /// (e.g., aggregates), so it cannot be used to free the buffer.
+    /// The second word points to the blocks that are to be sent beside
+    /// the message, if there are any.
+    static const std::size_t AM_ARG_PREFIX = 16;
+
+    namespace detail {
+
+        /// Returns the blocks to be sent beside an AmArg from alloc_am_arg (null if none)
+        inline AmBulkList*& am_arg_bulk(const AmArg* arg) {
+            unsigned char* p = reinterpret_cast<unsigned char*>(const_cast<AmArg*>(arg)) - AM_ARG_PREFIX;
+            return *reinterpret_cast<AmBulkList**>(p + sizeof(std::size_t));
+        }
+
+    } // namespace detail
+
     /// Allocates a new AmArg with nbytes of user data ... delete with free_am_arg
     inline AmArg* alloc_am_arg(std::size_t nbyte) {
         std::size_t narg = 1 + (nbyte+sizeof(AmArg)-1)/sizeof(AmArg);
-        AmArg *arg = new AmArg[narg];
+        std::size_t total = narg*sizeof(AmArg) + AM_ARG_PREFIX;
+        unsigned char* p = static_cast<unsigned char*>(pool_allocate(total));
+        *reinterpret_cast<std::size_t*>(p) = total;
+        AmArg *arg = new (p + AM_ARG_PREFIX) AmArg;
         arg->set_size(nbyte);
+        detail::am_arg_bulk(arg) = nullptr;
         return arg;
     }
 
@@ -176,7 +228,9 @@ namespace madness {
     /// Frees an AmArg allocated with alloc_am_arg
     inline void free_am_arg(AmArg* arg) {
         //std::cout << " freeing amarg " << (void*)(arg) << " " << pthread_self() << std::endl;
-        delete [] arg;
+        delete detail::am_arg_bulk(arg);
+        unsigned char* p = reinterpret_cast<unsigned char*>(arg) - AM_ARG_PREFIX;
+        pool_deallocate(p, *reinterpret_cast<std::size_t*>(p));
     }
 
     /// Terminate argument serialization
@@ -189,24 +243,117 @@ namespace madness {
         serialize_am_args(archive & t, std::forward<argT>(args)...);
     }
 
+    namespace detail {
+
+        /// Grows the AmArg that a BufferOutputArchive is serializing into
+
+        /// \c owner points to the AmArg*, which is replaced by one at
+        /// least twice as large holding the first \c used bytes.
+        inline unsigned char* grow_am_arg(void* owner, std::size_t used, std::size_t need, std::size_t& nbyte) {
+            AmArg*& arg = *static_cast<AmArg**>(owner);
+            const std::size_t n = std::max(2*nbyte, need);
+            AmArg* bigger = alloc_am_arg(n);
+            memcpy(bigger->buf(), arg->buf(), used);
+            std::swap(am_arg_bulk(bigger), am_arg_bulk(arg));
+            free_am_arg(arg);
+            arg = bigger;
+            nbyte = n;
+            return bigger->buf();
+        }
+
+        /// Takes a block to send beside the AmArg that a BufferOutputArchive is serializing into
+
+        /// \c owner points to the AmArg*.  Returns the tag the block will be sent with.
+        inline unsigned long attach_am_bulk(void* owner, const void* p, std::size_t nbyte, std::shared_ptr<const void> keeper) {
+            AmBulkList*& list = am_arg_bulk(*static_cast<AmArg**>(owner));
+            if (!list) list = new AmBulkList;
+            const int tag = RMI::bulk_tag();
+            list->push_back(AmBulk{p, nbyte, tag, std::move(keeper)});
+            return tag;
+        }
+
+        /// Serializes arguments in one pass, optionally sending large blocks beside them
+
+        /// The buffer starts the size of the last message made from the
+        /// same argument types and grows (by copying) if it is too small.
+        /// \param[in] bulk_min Smallest block sent beside the message, or zero for none
+        template <typename... argT>
+        inline AmArg* serialize_new_am_arg(std::size_t bulk_min, const argT&... args) {
+            static std::atomic<std::size_t> last_size{256};
+            const std::size_t guess = last_size.load(std::memory_order_relaxed);
+            AmArg* am_args = alloc_am_arg(guess);
+            archive::BufferOutputArchive ar(am_args->buf(), guess, grow_am_arg, &am_args);
+            if (bulk_min) ar.set_bulk(attach_am_bulk, bulk_min);
+            serialize_am_args(ar, args...);
+            const std::size_t nbyte = ar.size();
+            am_args->set_size(nbyte);
+            if (bulk_min) am_args->set_bulk();
+            if (nbyte != guess) last_size.store(nbyte, std::memory_order_relaxed);
+            return am_args;
+        }
+
+    } // namespace detail
+
     /// Convenience template for serializing arguments into a new AmArg
+
+    /// If all arguments are trivially serializable the size is known at
+    /// compile time.  Otherwise the arguments are serialized in one pass
+    /// into a buffer the size of the last message made from the same
+    /// argument types, which grows (by copying) if it is too small.
     template <typename... argT>
     inline AmArg* new_am_arg(const argT&... args) {
-        // compute size
-        archive::BufferOutputArchive count;
-        serialize_am_args(count, args...);
-
-        // Serialize arguments
-        AmArg* am_args = alloc_am_arg(count.size());
-        serialize_am_args(*am_args, args...);
-        return am_args;
+        if constexpr ((is_trivially_serializable<argT>::value && ...)) {
+            constexpr std::size_t nbyte = (std::size_t(0) + ... + sizeof(argT));
+            AmArg* am_args = alloc_am_arg(nbyte);
+            archive::BufferOutputArchive ar(am_args->buf(), nbyte);
+            serialize_am_args(ar, args...);
+            MADNESS_ASSERT(ar.size() == nbyte);
+            return am_args;
+        }
+        else {
+            return detail::serialize_new_am_arg(0, args...);
+        }
+    }
+
+    /// As new_am_arg, but large tensors are sent beside the message rather than in it
+
+    /// Data of at least RMI::bulk_threshold() bytes that supports it
+    /// (presently the data of a Tensor) is sent as a separate MPI
+    /// message straight from where it is, and received straight into
+    /// the object that the receiver deserializes.  So the message must
+    /// be sent once, with WorldAmInterface::send, and its arguments
+    /// deserialized once by the receiver, and the data must not be
+    /// modified in place (though it may be destroyed) after the message
+    /// is made.  WorldObject uses this for the messages and tasks it
+    /// sends.
+    template <typename... argT>
+    inline AmArg* new_am_arg_bulk(const argT&... args) {
+        if constexpr ((is_trivially_serializable<argT>::value && ...)) {
+            return new_am_arg(args...);
+        }
+        else {
+            return detail::serialize_new_am_arg(RMI::bulk_threshold(), args...);
+        }
     }
 
 
+    /// Statistics of the managed send buffers
+    struct AmSendStats {
+        uint64_t nsend;         ///< Current no. of send slots
+        uint64_t nmax;          ///< Max. no. of sends pending at once
+        uint64_t ngrow;         ///< No. of times the slots were increased
+        uint64_t nstall;        ///< No. of sends that waited for a slot
+        double stall_time;      ///< Total time (s) sends waited for a slot
+
+        AmSendStats() : nsend(0), nmax(0), ngrow(0), nstall(0), stall_time(0.0) {}
+    };
+
+
     /// Implements AM interface
     class WorldAmInterface : private SCALABLE_MUTEX_TYPE {
         friend class WorldGopInterface;
         friend class World;
+        friend void detail::fetch_am_bulk(const void* owner, unsigned long tag, void* p, std::size_t nbyte);
     private:
 
 #ifdef HAVE_CRAYXT
@@ -215,15 +362,16 @@ namespace madness {
         static const int DEFAULT_NSEND = 128;
 #endif
 
-        class SendReq : public SPINLOCK_TYPE, public RMISendReq {
+        static const int DEFAULT_NSEND_MAX = 4096;
+
+        /// A message sent by the server thread, which completes it in its main loop
+        class SendReq : public RMISendReq {
             AmArg* buf;
             RMI::Request req;
             void free() {if (buf) {free_am_arg(buf); buf=0;}}
         public:
-            SendReq() : buf(0) {}
-            SendReq(AmArg* b, const RMI::Request& r) : buf(b), req(r) {} // lock is NOT set
-            void set(AmArg* b, const RMI::Request& r) {buf=b; req=r;} // assumes lock held
-            bool TestAndFree() { // assumes lock held if necessary
+            SendReq(AmArg* b, const RMI::Request& r) : buf(b), req(r) {}
+            bool TestAndFree() {
                 if (buf) {
                     bool ok = req.Test(); 
                     if (ok) free(); 
@@ -239,22 +387,126 @@ namespace madness {
         // Multiple threads are making their way thru here ... must be careful
         // to ensure updates are atomic and consistent
 
-        int nsend;                          ///< Max no. of pending sends
-        std::unique_ptr<SendReq []> send_req; ///< Send requests and managed buffers 
+        // The send slots (send_req, send_buf, send_free and send_stats)
+        // are protected by the mutex of this class.  A slot is taken
+        // from send_free, its message is sent without the lock held,
+        // and it returns to send_free once a Testsome finds the send
+        // complete.  When no slot is free the slots are doubled, up to
+        // nsend_max, after which senders wait.
+
+        int nsend;                          ///< No. of send slots
+        int nsend_max;                      ///< Max. no. of send slots
+        std::vector<RMI::Request> send_req; ///< Pending sends (null if free or being sent)
+        std::vector<AmArg*> send_buf;       ///< Managed buffers of the pending sends
+        std::vector<int> send_free;         ///< Free slots
+        AmSendStats send_stats;
         unsigned long worldid;              ///< The world which contains this instance of WorldAmInterface
         const ProcessID rank;
         const int nproc;
-        volatile int cur_msg;               ///< Index of next buffer to attempt to use
         volatile unsigned long nsent;       ///< Counts no. of AM sent for purpose of termination detection
-        volatile unsigned long nrecv;       ///< Counts no. of AM received for purpose of termination detection
+        std::atomic<unsigned long> nrecv;   ///< Counts no. of AM received for purpose of termination detection
 
         std::vector<int> map_to_comm_world; ///< Maps rank in current MPI communicator to SafeMPI::COMM_WORLD
 
+        /// Small messages to one destination waiting to be sent together
+        struct AggregateBuffer : public Mutex {
+            AmArg* arg;             ///< Packed messages, or null if there are none
+            std::size_t nbyte;      ///< Bytes of the payload of arg in use
+            double start;           ///< Time the first message was packed
+
+            AggregateBuffer() : arg(nullptr), nbyte(0), start(0.0) {}
+            ~AggregateBuffer() { if (arg) free_am_arg(arg); }
+        };
+
+        std::size_t agg_nbyte;              ///< Payload size of an aggregate (0 if aggregation is disabled)
+        std::size_t agg_max_msg;            ///< Largest message (including AmArg) that is aggregated
+        std::unique_ptr<AggregateBuffer []> agg_buf; ///< Indexed by rank in this world
+        AtomicInt agg_npending;             ///< No. of destinations with packed messages
+        std::atomic<unsigned long> nagg_msg;  ///< No. of messages sent inside an aggregate
+        std::atomic<unsigned long> nagg_send; ///< No. of aggregates sent
+
+        static double agg_timeout;          ///< Max. time (s) a message is held before the server sends it
+
+        /// Space taken by a message inside an aggregate
+        static std::size_t aggregate_len(const AmArg* arg) {
+            const std::size_t align = alignof(std::max_align_t);
+            return (arg->size() + sizeof(AmArg) + align - 1) & ~(align - 1);
+        }
+
+        /// Runs each of the messages packed into an aggregate
+
+        /// Each counts as received, as does the aggregate itself when this returns
+        static void aggregate_handler(const AmArg& arg) {
+            WorldAmInterface& am = arg.get_world()->am;
+            const unsigned char* p = arg.buf();
+            const unsigned char* const end = p + arg.size();
+            while (p < end) {
+                const AmArg* msg = reinterpret_cast<const AmArg*>(p);
+                msg->get_func()(*msg);
+                am.nrecv++;  // Must be AFTER execution of the function
+                p += aggregate_len(msg);
+            }
+        }
+
+        /// Packs a small message into the aggregate for dest, taking ownership of arg
+        void aggregate(ProcessID dest, const AmArg* arg) {
+            const std::size_t len = aggregate_len(arg);
+            AggregateBuffer& b = agg_buf[dest];
+            b.lock();
+            // Counted now so that a fence cannot complete while it is held here
+            lock(); nsent++; unlock();
+            if (b.arg && b.nbyte + len > agg_nbyte) flush_aggregate(dest);
+            if (!b.arg) {
+                b.arg = alloc_am_arg(agg_nbyte);
+                b.nbyte = 0;
+                b.start = wall_time();
+                agg_npending++;
+            }
+            memcpy(b.arg->buf() + b.nbyte, arg, arg->size() + sizeof(AmArg));
+            b.nbyte += len;
+            b.unlock();
+            free_am_arg(const_cast<AmArg*>(arg));
+            ++nagg_msg;
+        }
+
+        /// Sends the aggregate for dest, if any ... assumes agg_buf[dest] is locked
+        void flush_aggregate(ProcessID dest) {
+            AggregateBuffer& b = agg_buf[dest];
+            if (!b.arg) return;
+            AmArg* arg = b.arg;
+            b.arg = nullptr;
+            agg_npending--;
+            arg->set_size(b.nbyte);
+            arg->set_worldid(worldid);
+            arg->set_src(rank);
+            arg->set_func(aggregate_handler);
+            arg->clear_flags();
+            ++nagg_send;
+            post(dest, arg, RMI::ATTR_ORDERED);
+        }
+
+        /// Sends aggregates held longer than the timeout ... never blocks
+        void flush_expired() {
+            if (agg_npending == 0) return;
+            const double now = wall_time();
+            for (ProcessID p=0; p<nproc; ++p) {
+                AggregateBuffer& b = agg_buf[p];
+                if (b.arg && b.try_lock()) {
+                    if (b.arg && (now - b.start) > agg_timeout) flush_aggregate(p);
+                    b.unlock();
+                }
+            }
+        }
+
+        /// Registered as the RMI poll hook while any instance aggregates
+        static void flush_expired_all();
+
         /// This handles all incoming RMI messages for all instances
         static void handler(void *buf, std::size_t nbyte) {
-            // It will be singled threaded since only the RMI receiver
-            // thread will invoke it ... however note that nrecv will
-            // be read by the main thread during fence operations.
+            // Only RMI server threads invoke it, and all messages from
+            // one source are handled by the same server, but with
+            // several servers nrecv is incremented concurrently.  It
+            // is also read by the main thread during fence operations.
             AmArg* arg = static_cast<AmArg*>(buf);
             am_handlerT func = arg->get_func();
             World* w = arg->get_world();
@@ -265,32 +517,19 @@ namespace madness {
             w->am.nrecv++;  // Must be AFTER execution of the function
         }
 
-    public:
-        WorldAmInterface(World& world);
-
-        virtual ~WorldAmInterface();
-
-        /// Currently a noop
-        void fence() {}
-
-        /// Sends a managed non-blocking active message
-        void send(ProcessID dest, am_handlerT op, const AmArg* arg,
-                  const int attr=RMI::ATTR_ORDERED)
-        {
-            // Setup the header
-            {
-                AmArg* argx = const_cast<AmArg*>(arg);
-
-                argx->set_worldid(worldid);
-                argx->set_src(rank);
-                argx->set_func(op);
-                argx->clear_flags(); // Is this the right place for this?
-            }
-
-            // Sanity check
-            MADNESS_ASSERT(arg->get_world());
-            MADNESS_ASSERT(arg->get_func());
+        /// Sends the blocks that travel beside a message, which must precede it
+        void post_bulk(ProcessID dest, const AmArg* arg) {
+            detail::AmBulkList*& list = detail::am_arg_bulk(arg);
+            if (!list) return;
+            dest = map_to_comm_world[dest];
+            for (detail::AmBulk& b : *list)
+                RMI::bulk_isend(b.ptr, b.nbyte, dest, b.tag, std::move(b.keeper));
+            delete list;
+            list = nullptr;
+        }
 
+        /// Sends a message through a managed send buffer, taking ownership of arg
+        void post(ProcessID dest, const AmArg* arg, const int attr) {
             // Map dest from world's communicator to comm_world
             dest = map_to_comm_world[dest];
 
@@ -317,50 +556,159 @@ namespace madness {
             }
 
 
-            // Find a free buffer oldest first (in order to assist
-            // with flow control).  Exit loop with a lock on buffer.
+            // Take a free slot, growing or waiting if there is none
+            const int i = get_send_slot();
 
-            // This design will need nsend >= nthreads
-            int i=-1;
-            while (i == -1) {
-                lock();   // << Protect cur_msg and nsent;
-                if (send_req[cur_msg].try_lock()) { // << matching unlock at end of routine
-                    i = cur_msg;
-                    cur_msg = (cur_msg + 1) % nsend;
-                    nsent++;
+            RMI::Request req = RMI::isend(arg, arg->size()+sizeof(AmArg), dest, handler, attr);
+
+            lock();
+            send_req[i] = req;
+            send_buf[i] = (AmArg*)(arg);
+            unlock();
+        }
+
+        /// Frees the buffers of completed sends ... assumes lock held
+        void complete_sends() {
+            std::vector<int> ind(nsend);
+            int n = RMI::Request::Testsome(nsend, send_req.data(), ind.data());
+            for (int k=0; k<n; ++k) {  // n is MPI_UNDEFINED (<0) if no sends are pending
+                const int i = ind[k];
+                free_am_arg(send_buf[i]);
+                send_buf[i] = nullptr;
+                send_free.push_back(i);
+            }
+        }
+
+        /// Returns a free send slot and counts the message as sent
+        int get_send_slot() {
+            double stall_start = 0.0;
+            lock();
+            nsent++;
+            if (send_free.empty()) complete_sends();
+            while (send_free.empty()) {
+                if (nsend < nsend_max) {
+                    // Under pressure ... grow rather than wait
+                    const int nnew = std::min(nsend, nsend_max - nsend);
+                    send_req.resize(nsend + nnew);
+                    send_buf.resize(nsend + nnew, nullptr);
+                    for (int i=nsend+nnew-1; i>=nsend; --i) send_free.push_back(i);
+                    nsend += nnew;
+                    send_stats.nsend = nsend;
+                    ++(send_stats.ngrow);
+                }
+                else {
+                    // Apply back pressure by yielding until a send completes
+                    if (stall_start == 0.0) {
+                        stall_start = wall_time();
+                        ++(send_stats.nstall);
+                    }
+                    unlock();
+                    ThreadPool::await([this]() { return free_managed_buffers() > 0; }, false);
+                    lock();
+                    if (send_free.empty()) complete_sends();
                 }
-                unlock(); // << Protect cur_msg and nsent;
-            }                
-
-
-            // If the buffer is still in-use wait for it to complete
-            while (!send_req[i].TestAndFree()) {
-                // If the oldest message has still not completed then
-                // there is likely severe network or end-point
-                // congestion, so pause for 100us in a rather
-                // arbitrary attempt to decrease the injection rate.
-                // Both the server thread and this call to Test()
-                // should ensure progress.
-                myusleep(100);
             }
+            const int i = send_free.back();
+            send_free.pop_back();
+            send_stats.nmax = std::max(send_stats.nmax, uint64_t(nsend - send_free.size()));
+            if (stall_start != 0.0) send_stats.stall_time += wall_time() - stall_start;
+            unlock();
+            return i;
+        }
+
+    public:
+        WorldAmInterface(World& world);
+
+        virtual ~WorldAmInterface();
 
-            // Buffer is now free but still locked by me
-            send_req[i].set((AmArg*)(arg), RMI::isend(arg, arg->size()+sizeof(AmArg), dest, handler, attr));
-            send_req[i].unlock(); // << matches try_lock above
+        /// Sends all aggregated messages
+        void fence() {
+            if (agg_nbyte == 0 || agg_npending == 0) return;
+            for (ProcessID p=0; p<nproc; ++p) {
+                AggregateBuffer& b = agg_buf[p];
+                b.lock();
+                flush_aggregate(p);
+                b.unlock();
+            }
         }
 
-        /// Frees as many send buffers as possible, returning the number that are free
-        int free_managed_buffers() {
-            int nfree = 0;
-            for (int i=0; i<nsend; i++) {
-                if (send_req[i].try_lock()) { // Someone may be trying to put a message into this buffer
-                    if (send_req[i].TestAndFree()) nfree++;
-                    send_req[i].unlock();     // matching unlock
+        /// Enables aggregation of small messages, or disables it if nbyte is zero
+
+        /// Messages whose total size is at most 1/8 of nbyte are packed,
+        /// per destination, into a single RMI message of payload nbyte
+        /// which is sent once full, at a fence, or by the server thread
+        /// after the timeout set by \c MAD_AM_AGGREGATE_TIMEOUT.  Aggregation
+        /// only changes how this process sends, so processes need not agree.
+        /// Aggregated messages are always delivered in order.  Only call
+        /// this while no thread is sending, e.g., right after a fence.
+        /// @param[in] nbyte The aggregate size (at least 1024 and preferably
+        /// no more than the RMI buffer size, \c MAD_BUFFER_SIZE)
+        void set_aggregation(std::size_t nbyte);
+
+        /// Returns the aggregate size, or zero if aggregation is disabled
+        std::size_t get_aggregation() const { return agg_nbyte; }
+
+        /// Returns the no. of messages that were sent inside an aggregate
+        unsigned long get_naggregated() const { return nagg_msg; }
+
+        /// Returns the no. of aggregates sent
+        unsigned long get_naggregate_sends() const { return nagg_send; }
+
+        /// Sends a managed non-blocking active message
+        void send(ProcessID dest, am_handlerT op, const AmArg* arg,
+                  const int attr=RMI::ATTR_ORDERED)
+        {
+            // Setup the header
+            {
+                AmArg* argx = const_cast<AmArg*>(arg);
+
+                argx->set_worldid(worldid);
+                argx->set_src(rank);
+                argx->set_func(op);
+                argx->clear_flags(); // Is this the right place for this?
+            }
+
+            // Sanity check
+            MADNESS_ASSERT(arg->get_world());
+            MADNESS_ASSERT(arg->get_func());
+
+            if (arg->is_bulk()) post_bulk(dest, arg);
+
+            if (agg_nbyte) {
+                if (aggregate_len(arg) <= agg_max_msg) {
+                    aggregate(dest, arg);
+                }
+                else {
+                    // Keep this behind any smaller messages already packed for dest
+                    AggregateBuffer& b = agg_buf[dest];
+                    b.lock();
+                    flush_aggregate(dest);
+                    post(dest, arg, attr);
+                    b.unlock();
                 }
             }
+            else {
+                post(dest, arg, attr);
+            }
+        }
+
+        /// Frees as many send buffers as possible, returning the number that are free
+        int free_managed_buffers() {
+            lock();
+            complete_sends();
+            const int nfree = send_free.size();
+            unlock();
             return nfree;
         }
 
+        /// Returns statistics of the managed send buffers
+        AmSendStats get_send_stats() const {
+            lock();
+            AmSendStats result = send_stats;
+            unlock();
+            return result;
+        }
+
     };
 }
 
@@ -45,6 +45,9 @@
 
 #include <madness/world/parallel_archive.h>
 #include <madness/world/worldhashmap.h>
+#ifdef MADNESS_DC_OPEN_HASHMAP
+#include <madness/world/worldhashmap_open.h>
+#endif
 #include <madness/world/mpi_archive.h>
 #include <madness/world/world_object.h>
 
@@ -358,7 +361,11 @@ namespace madness {
         typedef const pairT const_pairT;
         typedef WorldContainerImpl<keyT,valueT,hashfunT> implT;
 
+#ifdef MADNESS_DC_OPEN_HASHMAP
+        typedef OpenHashMap< keyT,valueT,hashfunT > internal_containerT;
+#else
         typedef ConcurrentHashMap< keyT,valueT,hashfunT > internal_containerT;
+#endif
 
 	//typedef WorldObject< WorldContainerImpl<keyT, valueT, hashfunT> > worldobjT;
 
@@ -451,26 +458,35 @@ namespace madness {
         	pmap.reset(new WorldDCLocalPmap<keyT>(world));
         	pmap->register_callback(this);
 
+        	// Each process broadcasts all of its own items in a single buffer
+        	// so that large containers use the pipelined broadcast
+        	archive::BufferOutputArchive count;
+        	count & size();
+        	for (auto it=begin(); it!=end(); ++it) count & it->first & it->second;
+        	const std::size_t mynbyte = count.size();
+        	std::unique_ptr<unsigned char[]> mybuf(new unsigned char[mynbyte]);
+        	{
+        		archive::BufferOutputArchive ar(mybuf.get(), mynbyte);
+        		ar & size();
+        		for (auto it=begin(); it!=end(); ++it) ar & it->first & it->second;
+        	}
+
         	for (ProcessID rank=0; rank<world.size(); rank++) {
+        		std::size_t nbyte = mynbyte;
+        		world.gop.broadcast(nbyte, rank);
         		if (rank == world.rank()) {
-        			std::size_t sz = size();
-        			world.gop.broadcast_serializable(sz, rank);
-
-        			for (auto it=begin(); it!=end(); ++it) {
-        				keyT key = it->first;
-        				valueT value = it->second;
-        				world.gop.broadcast_serializable(key, rank);
-        				world.gop.broadcast_serializable(value, rank);
-        			}
+        			world.gop.broadcast(mybuf.get(), nbyte, rank);
         		}
         		else {
-        			size_t sz;
-        			world.gop.broadcast_serializable(sz, rank);
+        			std::unique_ptr<unsigned char[]> buf(new unsigned char[nbyte]);
+        			world.gop.broadcast(buf.get(), nbyte, rank);
+        			archive::BufferInputArchive ar(buf.get(), nbyte);
+        			std::size_t sz;
+        			ar & sz;
         			for (size_t i=0; i<sz; i++) {
         				keyT key;
         				valueT value;
-        				world.gop.broadcast_serializable(key, rank);
-        				world.gop.broadcast_serializable(value, rank);
+        				ar & key & value;
         				insert(pairT(key,value));
         			}
         		}
@@ -478,7 +494,7 @@ namespace madness {
         	if (fence) world.gop.fence();
         }
 
-        hashfunT& get_hash() const { return local.get_hash(); }
+        const hashfunT& get_hash() const { return local.get_hash(); }
 
         bool is_local(const keyT& key) const {
             return owner(key) == me;
@@ -1017,7 +1033,7 @@ namespace madness {
         }
 
         /// Returns a reference to the hashing functor
-        hashfunT& get_hash() const {
+        const hashfunT& get_hash() const {
             check_initialized();
             return p->get_hash();
         }
@@ -1260,6 +1276,20 @@ namespace madness {
         }
 
 
+        /// Returns \c attr with an affinity hint derived from \c key.
+
+        /// Tasks on the same key then prefer the same NUMA domain (see
+        /// \c SchedulerPolicy::NUMA). A hint already in \c attr is kept.
+        /// The hash is mixed since its low bits also decide the owner.
+        TaskAttributes key_affinity(const keyT& key, const TaskAttributes& attr) const {
+            TaskAttributes result(attr);
+            if (!result.has_affinity_hint()) {
+                const std::uint64_t h = std::uint64_t(get_hash()(key)) * 0x9E3779B97F4A7C15ull;
+                result.set_affinity_hint(std::size_t(h >> 40));
+            }
+            return result;
+        }
+
         /// Adds task "resultT memfun()" in process owning item (non-blocking comm if remote)
 
         /// If item does not exist it is made with the default constructor.
@@ -1275,7 +1305,7 @@ namespace madness {
         task(const keyT& key, memfunT memfun, const TaskAttributes& attr = TaskAttributes()) {
             check_initialized();
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT) = &implT:: template itemfun<memfunT>;
-            return p->task(owner(key), itemfun, key, memfun, attr);
+            return p->task(owner(key), itemfun, key, memfun, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T)" in process owning item (non-blocking comm if remote)
@@ -1294,7 +1324,7 @@ namespace madness {
             check_initialized();
             typedef REMFUTURE(arg1T) a1T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&) = &implT:: template itemfun<memfunT,a1T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T)" in process owning item (non-blocking comm if remote)
@@ -1314,7 +1344,7 @@ namespace madness {
             typedef REMFUTURE(arg1T) a1T;
             typedef REMFUTURE(arg2T) a2T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&) = &implT:: template itemfun<memfunT,a1T,a2T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T)" in process owning item (non-blocking comm if remote)
@@ -1335,7 +1365,7 @@ namespace madness {
             typedef REMFUTURE(arg2T) a2T;
             typedef REMFUTURE(arg3T) a3T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T)" in process owning item (non-blocking comm if remote)
@@ -1357,7 +1387,7 @@ namespace madness {
             typedef REMFUTURE(arg3T) a3T;
             typedef REMFUTURE(arg4T) a4T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T,arg5T)" in process owning item (non-blocking comm if remote)
@@ -1380,7 +1410,7 @@ namespace madness {
             typedef REMFUTURE(arg4T) a4T;
             typedef REMFUTURE(arg5T) a5T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&, const a5T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T,a5T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T,arg5T,arg6T)" in process owning item (non-blocking comm if remote)
@@ -1404,7 +1434,7 @@ namespace madness {
             typedef REMFUTURE(arg5T) a5T;
             typedef REMFUTURE(arg6T) a6T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&, const a5T&, const a6T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T,a5T,a6T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun(arg1T,arg2T,arg3T,arg4T,arg5T,arg6T,arg7T)" in process owning item (non-blocking comm if remote)
@@ -1429,7 +1459,7 @@ namespace madness {
             typedef REMFUTURE(arg6T) a6T;
             typedef REMFUTURE(arg7T) a7T;
             MEMFUN_RETURNT(memfunT)(implT::*itemfun)(const keyT&, memfunT, const a1T&, const a2T&, const a3T&, const a4T&, const a5T&, const a6T&, const a7T&) = &implT:: template itemfun<memfunT,a1T,a2T,a3T,a4T,a5T,a6T,a7T>;
-            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, arg7, attr);
+            return p->task(owner(key), itemfun, key, memfun, arg1, arg2, arg3, arg4, arg5, arg6, arg7, key_affinity(key, attr));
         }
 
         /// Adds task "resultT memfun() const" in process owning item (non-blocking comm if remote)
@@ -30,6 +30,9 @@
 */
 
 #include <limits>
+#include <vector>
+#include <cstdlib>
+#include <sstream>
 #include <madness/world/worldgop.h>
 #include <madness/world/MADworld.h>
 #ifdef MADNESS_HAS_GOOGLE_PERF_TCMALLOC
@@ -80,6 +83,7 @@ namespace madness {
             uint64_t ntask1, nsent1, nrecv1, ntask2, nsent2, nrecv2;
             do {
                 world_.taskq.fence();
+                world_.am.fence(); // Send aggregated messages, which are already counted in nsent
 
                 // Since the number of outstanding tasks and number of AM sent/recv
                 // don't share a critical section read each twice and ensure they
@@ -170,6 +174,29 @@ namespace madness {
       fence();
     }
 
+    namespace {
+        /// Reads a size in bytes from the environment
+        std::size_t getenv_nbyte(const char* name, std::size_t value) {
+            const char* env = getenv(name);
+            if (env) {
+                std::stringstream ss(env);
+                long long n;
+                if (ss >> n) value = (n > 0) ? std::size_t(n) : 0;
+            }
+            return value;
+        }
+    }
+
+    std::size_t WorldGopInterface::default_broadcast_segment() {
+        static const std::size_t nbyte = getenv_nbyte("MAD_BCAST_SEGMENT", 65536);
+        return nbyte;
+    }
+
+    std::size_t WorldGopInterface::default_broadcast_scatter() {
+        static const std::size_t nbyte = getenv_nbyte("MAD_BCAST_SCATTER", 4*1024*1024);
+        return nbyte;
+    }
+
     /// Broadcasts bytes from process root while still processing AM & tasks
     static void broadcast_impl(void* buf, int nbyte, ProcessID root, bool dowork, Tag bcast_tag, World &world) {
         SafeMPI::Request req0, req1;
@@ -190,14 +217,98 @@ namespace madness {
         if (child1 != -1) World::await(req1, dowork);
     }
 
-    /// Optimizations can be added for long messages
+    /// Broadcasts bytes down a binary tree a segment at a time
+
+    /// Each segment is forwarded as soon as it arrives, so after the pipe
+    /// fills every level of the tree is busy and the time approaches that
+    /// of one transfer rather than one per level.
+    static void broadcast_pipelined(char* buf, int nbyte, int segment, ProcessID root, bool dowork, Tag bcast_tag, World &world) {
+        ProcessID parent, child0, child1;
+        world.mpi.binary_tree_info(root, parent, child0, child1);
+
+        const int nseg = (nbyte + segment - 1)/segment;
+        const int window = 8;   // No. of segments in flight to or from each process
+        auto len = [=](int k) { return std::min(segment, nbyte - k*segment); };
+
+        std::vector<SafeMPI::Request> recv(nseg), send0(nseg), send1(nseg);
+        if (parent != -1) {
+            for (int k=0; k<std::min(window,nseg); ++k)
+                recv[k] = world.mpi.Irecv(buf + std::size_t(k)*segment, len(k), MPI_BYTE, parent, bcast_tag);
+        }
+        for (int k=0; k<nseg; ++k) {
+            if (parent != -1) {
+                World::await(recv[k], dowork);
+                const int knext = k + window;
+                if (knext < nseg)
+                    recv[knext] = world.mpi.Irecv(buf + std::size_t(knext)*segment, len(knext), MPI_BYTE, parent, bcast_tag);
+            }
+            if (k >= window) {
+                if (child0 != -1) World::await(send0[k-window], dowork);
+                if (child1 != -1) World::await(send1[k-window], dowork);
+            }
+            if (child0 != -1) send0[k] = world.mpi.Isend(buf + std::size_t(k)*segment, len(k), MPI_BYTE, child0, bcast_tag);
+            if (child1 != -1) send1[k] = world.mpi.Isend(buf + std::size_t(k)*segment, len(k), MPI_BYTE, child1, bcast_tag);
+        }
+        for (int k=std::max(0,nseg-window); k<nseg; ++k) {
+            if (child0 != -1) World::await(send0[k], dowork);
+            if (child1 != -1) World::await(send1[k], dowork);
+        }
+    }
+
+    /// Broadcasts bytes by scattering from the root then allgathering around a ring
+
+    /// Process i (relative to the root) receives the i-th of nproc chunks
+    /// from the root.  Then in each of nproc-1 steps every process passes
+    /// the chunk it last obtained to its right neighbor, so each process
+    /// sends and receives about 2*nbyte independent of the no. of processes.
+    static void broadcast_scatter_allgather(char* buf, int nbyte, ProcessID root, bool dowork, Tag bcast_tag, World &world) {
+        const int nproc = world.size();
+        const int rel = (world.rank() - root + nproc) % nproc;
+        const int chunk = (nbyte + nproc - 1)/nproc;
+        auto off = [=](int i) { return std::min(i*std::size_t(chunk), std::size_t(nbyte)); };
+        auto len = [=](int i) { return int(off(i+1) - off(i)); };
+        auto proc = [=](int i) { return (i + root) % nproc; };
+
+        if (rel == 0) {
+            std::vector<SafeMPI::Request> req(nproc);
+            for (int i=1; i<nproc; ++i)
+                if (len(i)) req[i] = world.mpi.Isend(buf + off(i), len(i), MPI_BYTE, proc(i), bcast_tag);
+            for (int i=1; i<nproc; ++i)
+                if (len(i)) World::await(req[i], dowork);
+        }
+        else if (len(rel)) {
+            SafeMPI::Request req = world.mpi.Irecv(buf + off(rel), len(rel), MPI_BYTE, root, bcast_tag);
+            World::await(req, dowork);
+        }
+
+        // The root already has everything and so is skipped as a receiver
+        const ProcessID left = proc((rel + nproc - 1) % nproc);
+        const ProcessID right = proc((rel + 1) % nproc);
+        for (int step=0; step<nproc-1; ++step) {
+            const int isend = (rel - step + nproc) % nproc;
+            const int irecv = (rel - step - 1 + nproc) % nproc;
+            SafeMPI::Request reqr, reqs;
+            const bool dorecv = (rel != 0) && len(irecv);
+            const bool dosend = (rel != nproc-1) && len(isend);
+            if (dorecv) reqr = world.mpi.Irecv(buf + off(irecv), len(irecv), MPI_BYTE, left, bcast_tag);
+            if (dosend) reqs = world.mpi.Isend(buf + off(isend), len(isend), MPI_BYTE, right, bcast_tag);
+            if (dorecv) World::await(reqr, dowork);
+            if (dosend) World::await(reqs, dowork);
+        }
+    }
+
     void WorldGopInterface::broadcast(void* buf, size_t nbyte, ProcessID root, bool dowork, Tag bcast_tag) {
       if(bcast_tag < 0)
         bcast_tag = world_.mpi.unique_tag();
       const size_t int_max = static_cast<size_t>(std::numeric_limits<int>::max());
       while (nbyte) {
         const int n = static_cast<int>(std::min(int_max, nbyte));
-        broadcast_impl(buf, n, root, dowork, bcast_tag, world_);
+        if (world_.size() > 2 && bcast_scatter_ && size_t(n) >= bcast_scatter_)
+            broadcast_scatter_allgather(static_cast<char*>(buf), n, root, dowork, bcast_tag, world_);
+        else if (bcast_segment_ && size_t(n) > bcast_segment_)
+            broadcast_pipelined(static_cast<char*>(buf), n, int(std::min(bcast_segment_, int_max)), root, dowork, bcast_tag, world_);
+        else
+            broadcast_impl(buf, n, root, dowork, bcast_tag, world_);
         nbyte -= n;
         buf = static_cast<char*>(buf) + n;
       }
@@ -38,8 +38,10 @@
 /// If you can recall the Intel hypercubes, their comm lib used GOP as
 /// the abbreviation.
 
+#include <algorithm>
 #include <functional>
 #include <type_traits>
+#include <vector>
 #include <madness/world/worldtypes.h>
 #include <madness/world/buffer_archive.h>
 #include <madness/world/world.h>
@@ -47,6 +49,7 @@
 #include <madness/world/world_task_queue.h>
 #include <madness/world/group.h>
 #include <madness/world/dist_cache.h>
+#include <madness/world/distributed_id.h>
 
 namespace madness {
 
@@ -147,6 +150,8 @@ namespace madness {
         std::shared_ptr<detail::DeferredCleanup> deferred_; ///< Deferred cleanup object.
         bool debug_; ///< Debug mode
         bool forbid_fence_=false; ///< forbid calling fence() in case of several active worlds
+        std::size_t bcast_segment_; ///< Segment size of pipelined broadcasts (0 disables pipelining)
+        std::size_t bcast_scatter_; ///< Min. size of scatter-allgather broadcasts (0 disables them)
 
         friend class detail::DeferredCleanup;
 
@@ -160,6 +165,8 @@ namespace madness {
         struct GroupReduceTag { };
         struct AllReduceTag { };
         struct GroupAllReduceTag { };
+        struct IAllReduceTag { };
+        struct IBcastTag { };
 
 
         /// Delayed send callback object
@@ -564,6 +571,43 @@ namespace madness {
             return result.get();
         }
 
+        /// Elementwise reduction of arrays, used by the non-blocking collectives
+
+        /// The default result is an empty vector, which is replaced by the
+        /// first argument reduced into it.
+        /// \tparam T The element type
+        /// \tparam opT The binary operation applied to elements (e.g. \c WorldSumOp<T>)
+        template <typename T, typename opT>
+        struct ArrayReduceOp {
+            typedef std::vector<T> result_type;
+            typedef std::vector<T> argument_type;
+
+            opT op;
+
+            ArrayReduceOp(const opT& op) : op(op) { }
+
+            result_type operator()() const { return result_type(); }
+
+            void operator()(result_type& result, const argument_type& arg) const {
+                if(result.empty()) {
+                    result = arg;
+                } else {
+                    MADNESS_ASSERT(result.size() == arg.size());
+                    for(std::size_t i = 0ul; i < result.size(); ++i)
+                        result[i] = op(result[i], arg[i]);
+                }
+            }
+        }; // struct ArrayReduceOp
+
+        /// Copy the result of a non-blocking array reduction into the user buffer
+
+        /// \return The completion status, always true
+        template <typename T>
+        static bool array_unpack_task(const std::vector<T>& result, T* buf) {
+            std::copy(result.begin(), result.end(), buf);
+            return true;
+        }
+
         /// Distributed reduce
 
         /// \tparam tagT The tag type to be added to the key type
@@ -614,6 +658,48 @@ namespace madness {
             return Future<result_type>::default_initializer();
         }
 
+        /// Distributed all reduce
+
+        /// \tparam tagT The tag type to be added to the key type
+        /// \tparam keyT The key type
+        /// \tparam valueT The data type to be reduced (this may be a \c Future type)
+        /// \tparam opT The reduction operation type
+        /// \param key The key associated with this reduction
+        /// \param value The local value to be reduced
+        /// \param op The reduction operation to be applied to local and remote data
+        /// \return A future to the reduced value on every process
+        template <typename tagT, typename keyT, typename valueT, typename opT>
+        Future<typename detail::result_of<opT>::type>
+        all_reduce_internal(const keyT& key, const valueT& value, const opT& op) {
+            // Compute the parent and child processes of this process in a binary tree.
+            Hash<keyT> hasher;
+            const ProcessID root = hasher(key) % world_.size();
+            ProcessID parent = -1, child0 = -1, child1 = -1;
+            world_.mpi.binary_tree_info(root, parent, child0, child1);
+
+            // Reduce the data
+            Future<typename detail::result_of<opT>::type> reduce_result =
+                    reduce_internal<tagT>(parent, child0, child1, root,
+                            key, value, op);
+
+            if(world_.rank() != root)
+                reduce_result = Future<typename detail::result_of<opT>::type>();
+
+            // Broadcast the result of the reduction to all processes
+            bcast_internal<tagT>(key, reduce_result, root);
+
+            return reduce_result;
+        }
+
+        /// Key for the next non-blocking collective
+
+        /// Non-blocking collectives are matched across processes by the order
+        /// in which they are issued, like the blocking ones, so the key is
+        /// drawn from the same counter that names world objects.
+        DistributedID next_collective_key() {
+            return DistributedID(world_.unique_obj_id(), 0ul);
+        }
+
         /// Implementation of fence
 
         /// \param[in] epilogue the action to execute (by the calling thread) immediately after the fence
@@ -624,11 +710,19 @@ namespace madness {
                         bool pause_during_epilogue = false,
                         bool debug = false);
 
+        /// Default segment size of pipelined broadcasts, from MAD_BCAST_SEGMENT
+        static std::size_t default_broadcast_segment();
+
+        /// Default min. size of scatter-allgather broadcasts, from MAD_BCAST_SCATTER
+        static std::size_t default_broadcast_scatter();
+
     public:
 
         // In the World constructor can ONLY rely on MPI and MPI being initialized
         WorldGopInterface(World& world) :
             world_(world), deferred_(new detail::DeferredCleanup()), debug_(false)
+            , bcast_segment_(default_broadcast_segment())
+            , bcast_scatter_(default_broadcast_scatter())
         { }
 
         ~WorldGopInterface() {
@@ -650,6 +744,30 @@ namespace madness {
             forbid_fence_ = value;
             return status;
         }
+
+        /// Set the segment size of pipelined broadcasts and return old value
+
+        /// Broadcasts longer than one segment are forwarded down the tree
+        /// a segment at a time, so that all levels of the tree are busy at
+        /// once.  Zero disables pipelining.  Must be the same on all processes.
+        std::size_t set_broadcast_segment(std::size_t nbyte) {
+            std::size_t status = bcast_segment_;
+            bcast_segment_ = nbyte;
+            return status;
+        }
+
+        /// Set the size from which broadcasts scatter then allgather and return old value
+
+        /// For more than two processes, broadcasts of at least this many
+        /// bytes are scattered from the root and then gathered around a
+        /// ring, so that each process sends and receives about twice the
+        /// data regardless of the number of processes.  Zero disables this.
+        /// Must be the same on all processes.
+        std::size_t set_broadcast_scatter(std::size_t nbyte) {
+            std::size_t status = bcast_scatter_;
+            bcast_scatter_ = nbyte;
+            return status;
+        }
         /// Synchronizes all processes in communicator ... does NOT fence pending AM or tasks
         void barrier() {
             long i = world_.rank();
@@ -677,13 +795,13 @@ namespace madness {
 
         /// Broadcasts bytes from process root while still processing AM & tasks
 
-        /// Optimizations can be added for long messages
+        /// Short messages go down a binary tree, long ones are pipelined
+        /// down the tree and very long ones are scattered then gathered
+        /// (see set_broadcast_segment() and set_broadcast_scatter())
         void broadcast(void* buf, size_t nbyte, ProcessID root, bool dowork = true, Tag bcast_tag = -1);
 
 
         /// Broadcasts typed contiguous data from process root while still processing AM & tasks
-
-        /// Optimizations can be added for long messages
         template <typename T>
         inline void broadcast(T* buf, size_t nelem, ProcessID root) {
             broadcast((void *) buf, nelem*sizeof(T), root);
@@ -855,6 +973,85 @@ namespace madness {
             min(&a, 1);
         }
 
+        /// Non-blocking global reduction of a value, which may be a \c Future
+
+        /// Must be called by all processes in the same order relative to other
+        /// collectives. The reduction proceeds in tasks and active messages, so
+        /// the caller is free to submit work and wait (e.g., in a fence) later.
+        /// See \c all_reduce for the required signature of \c op .
+        /// \tparam valueT The data type to be reduced (this may be a \c Future type)
+        /// \tparam opT The reduction operation type
+        /// \param value The local value to be reduced
+        /// \param op The reduction operation to be applied to local and remote data
+        /// \return A future to the reduced value, on every process
+        template <typename valueT, typename opT>
+        Future<typename detail::result_of<opT>::type>
+        ireduce(const valueT& value, const opT& op) {
+            return all_reduce_internal<IAllReduceTag>(next_collective_key(), value, op);
+        }
+
+        /// Non-blocking inplace global reduction of an array
+
+        /// The contents of \c buf must not be read or modified until the
+        /// returned future is set.
+        /// \param[in,out] buf The local values on input, the reduced values on output
+        /// \param nelem The number of elements in \c buf
+        /// \param op The elementwise binary operation (e.g. \c WorldSumOp<T>)
+        /// \return A future completion status that is set once \c buf holds the result
+        template <typename T, class opT>
+        Future<bool> ireduce(T* buf, std::size_t nelem, opT op) {
+            Future<std::vector<T> > result =
+                    ireduce(std::vector<T>(buf, buf + nelem), ArrayReduceOp<T, opT>(op));
+            return world_.taskq.add(WorldGopInterface::template array_unpack_task<T>,
+                    result, buf, TaskAttributes::hipri());
+        }
+
+        /// Non-blocking inplace global sum
+
+        /// \return A future completion status that is set once \c buf holds the result
+        template <typename T>
+        inline Future<bool> isum(T* buf, std::size_t nelem) {
+            return ireduce(buf, nelem, WorldSumOp<T>());
+        }
+
+        /// Non-blocking inplace global min
+
+        /// \return A future completion status that is set once \c buf holds the result
+        template <typename T>
+        inline Future<bool> imin(T* buf, std::size_t nelem) {
+            return ireduce(buf, nelem, WorldMinOp<T>());
+        }
+
+        /// Non-blocking inplace global max
+
+        /// \return A future completion status that is set once \c buf holds the result
+        template <typename T>
+        inline Future<bool> imax(T* buf, std::size_t nelem) {
+            return ireduce(buf, nelem, WorldMaxOp<T>());
+        }
+
+        /// Non-blocking broadcast of a value, which may be a \c Future
+
+        /// Must be called by all processes in the same order relative to other
+        /// collectives.
+        /// \tparam valueT The value type (this may be a \c Future type)
+        /// \param value The data to broadcast; ignored except on \c root
+        /// \param root The process that owns the data
+        /// \return A future to the broadcast value, on every process
+        template <typename valueT>
+        Future<typename remove_future<valueT>::type>
+        ibroadcast(const valueT& value, const ProcessID root) {
+            MADNESS_ASSERT((root >= 0) && (root < world_.size()));
+            typedef typename remove_future<valueT>::type value_type;
+
+            const DistributedID key = next_collective_key();
+            Future<value_type> result = (world_.rank() == root) ?
+                    Future<value_type>(value) : Future<value_type>();
+            bcast_internal<IBcastTag>(key, result, root);
+
+            return result;
+        }
+
         /// Concatenate an STL vector of serializable stuff onto node 0
 
         /// \param[in] v input vector
@@ -1233,24 +1430,7 @@ namespace madness {
         template <typename keyT, typename valueT, typename opT>
         Future<typename detail::result_of<opT>::type>
         all_reduce(const keyT& key, const valueT& value, const opT& op) {
-            // Compute the parent and child processes of this process in a binary tree.
-            Hash<keyT> hasher;
-            const ProcessID root = hasher(key) % world_.size();
-            ProcessID parent = -1, child0 = -1, child1 = -1;
-            world_.mpi.binary_tree_info(root, parent, child0, child1);
-
-            // Reduce the data
-            Future<typename detail::result_of<opT>::type> reduce_result =
-                    reduce_internal<AllReduceTag>(parent, child0, child1, root,
-                            key, value, op);
-
-            if(world_.rank() != root)
-                reduce_result = Future<typename detail::result_of<opT>::type>();
-
-            // Broadcast the result of the reduction to all processes
-            bcast_internal<AllReduceTag>(key, reduce_result, root);
-
-            return reduce_result;
+            return all_reduce_internal<AllReduceTag>(key, value, op);
         }
 
         /// Distributed, group all reduce
@@ -57,6 +57,9 @@ namespace madness {
     template <class keyT, class valueT, class hashfunT>
     class ConcurrentHashMap;
 
+    template <class keyT, class valueT, class hashfunT>
+    class OpenHashMap;
+
     namespace Hash_private {
 
         // A hashtable is an array of nbin bins.
@@ -329,6 +332,7 @@ namespace madness {
         template <class hashT, int lockmode>
         class HashAccessor : private NO_DEFAULTS {
             template <class a,class b,class c> friend class madness::ConcurrentHashMap;
+            template <class a,class b,class c> friend class madness::OpenHashMap;
         public:
             typedef typename std::conditional<std::is_const<hashT>::value,
                     typename std::add_const<typename hashT::entryT>::type,
@@ -590,7 +594,7 @@ namespace madness {
             return const_iterator(this,false);
         }
 
-        hashfunT& get_hash() const { return hashfun; }
+        const hashfunT& get_hash() const { return hashfun; }
 
         void print_stats() const {
             for (unsigned int i=0; i<nbins; ++i) {
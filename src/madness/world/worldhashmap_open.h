@@ -0,0 +1,842 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_WORLDHASHMAP_OPEN_H__INCLUDED
+#define MADNESS_WORLD_WORLDHASHMAP_OPEN_H__INCLUDED
+
+/// \file worldhashmap_open.h
+/// \brief Defines and implements an open-addressing concurrent hashmap
+
+// OpenHashMap has the same interface as ConcurrentHashMap (iterators,
+// accessors with per-entry reader/writer locks, Range support) but a
+// different layout:
+//
+// - The table is an array of cache-line sized buckets, each holding
+//   pointers to seven entries and an 8-bit tag from the hash of each
+//   key, so that most probes touch one cache line and no entry that
+//   does not match.
+// - Lookups take no locks.  Insertion and removal serialize on one of
+//   a fixed number of stripe locks chosen by the hash of the key, and
+//   the entries are allocated from chunks owned by that stripe rather
+//   than one at a time from the heap.
+// - Entries never move, so references and accessors stay valid while
+//   the table grows.  Growing takes all stripe locks and builds a new
+//   table of pointers; the old one is kept (and entries removed later
+//   are removed from it too) until clear() or destruction, so that
+//   iterators and concurrent lookups into it remain safe.
+// - Removed entries are reclaimed once no thread can still be looking
+//   at them, using epoch-based reclamation shared by all maps.
+//
+// As with ConcurrentHashMap, an entry may only be removed while no
+// other thread holds an accessor to it or iterates over the map.
+
+#include <madness/world/worldmutex.h>
+#include <madness/world/madness_exception.h>
+#include <madness/world/worldhash.h>
+#include <madness/world/worldhashmap.h>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stdio.h>
+
+namespace madness {
+
+    template <class keyT, class valueT, class hashfunT> class OpenHashMap;
+
+    namespace Hash_private {
+
+        /// Epoch-based reclamation of the entries removed from any OpenHashMap
+
+        /// A thread that may dereference entries without holding a lock
+        /// announces the global epoch on entry to the critical section.
+        /// Entries are retired with the epoch at which they were unlinked,
+        /// and may be destroyed once every thread inside a critical section
+        /// announced a later epoch.
+        class EpochDomain {
+        public:
+            static const int MAXTHREAD = 1024; ///< Max. no. of threads alive at once
+
+        private:
+            struct alignas(64) Record {
+                std::atomic<unsigned long> epoch; ///< Announced epoch, 0 outside a critical section
+                std::atomic<bool> used;           ///< Record belongs to a live thread
+                Record() : epoch(0), used(false) {}
+            };
+
+            struct ThreadRecord {
+                int index;
+                int depth;
+                ThreadRecord() : index(acquire()), depth(0) {}
+                ~ThreadRecord() { records[index].used.store(false); }
+            };
+
+            static inline std::atomic<unsigned long> global{1};
+            static inline std::atomic<int> nrecord{0}; ///< High-water mark of records in use
+            static inline Record records[MAXTHREAD];
+
+            static int acquire() {
+                for (int i=0; i<MAXTHREAD; ++i) {
+                    bool unused = false;
+                    if (!records[i].used.load(std::memory_order_relaxed) &&
+                        records[i].used.compare_exchange_strong(unused, true)) {
+                        int n = nrecord.load();
+                        while (n <= i && !nrecord.compare_exchange_weak(n, i+1)) {}
+                        return i;
+                    }
+                }
+                MADNESS_EXCEPTION("EpochDomain: too many threads", MAXTHREAD);
+            }
+
+            static ThreadRecord& thread_record() {
+                thread_local ThreadRecord r;
+                return r;
+            }
+
+        public:
+            /// Enter a critical section (may be nested)
+            static void enter() {
+                ThreadRecord& r = thread_record();
+                if (r.depth++ == 0) {
+                    records[r.index].epoch.store(global.load());
+                    // Order the announcement before reading the table
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                }
+            }
+
+            /// Leave a critical section
+            static void exit() {
+                ThreadRecord& r = thread_record();
+                if (--r.depth == 0) records[r.index].epoch.store(0, std::memory_order_release);
+            }
+
+            /// Returns the epoch with which to retire an entry that was just unlinked
+            static unsigned long retire() {
+                // Order the unlinking before reading the announcements
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return global.fetch_add(1);
+            }
+
+            /// Returns the oldest epoch announced by a thread in a critical section
+
+            /// Entries retired with an earlier epoch may be destroyed.
+            static unsigned long oldest() {
+                unsigned long result = std::numeric_limits<unsigned long>::max();
+                const int n = nrecord.load();
+                for (int i=0; i<n; ++i) {
+                    unsigned long e = records[i].epoch.load();
+                    if (e && e < result) result = e;
+                }
+                return result;
+            }
+        };
+
+        /// Scoped critical section of the EpochDomain
+        class EpochGuard : private NO_DEFAULTS {
+        public:
+            EpochGuard() { EpochDomain::enter(); }
+            ~EpochGuard() { EpochDomain::exit(); }
+        };
+
+        /// Entry in an OpenHashMap: the key+value pair, its hash and a read-write mutex
+        template <typename keyT, typename valueT>
+        class open_entry : public madness::MutexReaderWriter {
+        public:
+            typedef std::pair<const keyT, valueT> datumT;
+            datumT datum;
+            const madness::hashT hash;
+            std::atomic<bool> dead;   ///< Set once unlinked from the table
+
+            open_entry(const datumT& datum, madness::hashT hash)
+                    : datum(datum), hash(hash), dead(false) {}
+        };
+
+        /// Cache-line sized bucket of entry pointers with a tag byte per entry
+
+        /// A slot is null until first used and is never null again (until
+        /// the table is discarded), so a probe for a key can stop at the
+        /// first null slot.  Removed entries leave a tombstone that may be
+        /// reused by a later insertion.
+        template <typename entryT>
+        struct alignas(64) open_bucket {
+            static const int NSLOT = 7;
+            std::atomic<entryT*> slot[NSLOT];
+            std::atomic<std::uint8_t> tag[NSLOT];
+
+            open_bucket() {
+                for (int i=0; i<NSLOT; ++i) {
+                    slot[i].store(nullptr, std::memory_order_relaxed);
+                    tag[i].store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        /// Table of buckets (the number of buckets is a power of two)
+        template <typename entryT>
+        struct open_table {
+            typedef open_bucket<entryT> bucketT;
+            const std::size_t nbucket;
+            bucketT* const buckets;
+
+            open_table(std::size_t nbucket) : nbucket(nbucket), buckets(new bucketT[nbucket]) {}
+            ~open_table() { delete [] buckets; }
+
+            std::size_t nslot() const { return nbucket*bucketT::NSLOT; }
+
+            std::atomic<entryT*>& slot(std::size_t pos) const {
+                return buckets[pos/bucketT::NSLOT].slot[pos%bucketT::NSLOT];
+            }
+        };
+
+        /// Iterator for OpenHashMap
+
+        /// Iterates over the table that was current when the iterator was made.
+        template <class hashT> class OpenHashIterator {
+        public:
+            typedef typename std::conditional<std::is_const<hashT>::value,
+                    typename std::add_const<typename hashT::entryT>::type,
+                    typename hashT::entryT>::type entryT;
+            typedef typename std::conditional<std::is_const<hashT>::value,
+                    typename std::add_const<typename hashT::datumT>::type,
+                    typename hashT::datumT>::type datumT;
+            typedef typename hashT::tableT tableT;
+            typedef std::forward_iterator_tag iterator_category;
+            typedef datumT value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef datumT* pointer;
+            typedef datumT& reference;
+
+        private:
+            hashT* h;               // Associated hash table
+            const tableT* t;        // Table being iterated
+            std::size_t pos;        // Current slot
+            entryT* entry;          // Current entry ... zero means at end
+
+            template <class otherHashT>
+            friend class OpenHashIterator;
+
+            /// Starting at pos finds the next slot holding an entry
+            void next_live_entry() {
+                const std::size_t nslot = t->nslot();
+                for (; pos<nslot; ++pos) {
+                    entryT* e = t->slot(pos).load(std::memory_order_acquire);
+                    if (hashT::is_live(e)) {
+                        entry = e;
+                        return;
+                    }
+                }
+                entry = 0;
+            }
+
+        public:
+
+            /// Makes invalid iterator
+            OpenHashIterator() : h(0), t(0), pos(0), entry(0) {}
+
+            /// Makes begin/end iterator
+            OpenHashIterator(hashT* h, bool begin)
+                    : h(h), t(h->current_table()), pos(0), entry(0) {
+                if (begin) next_live_entry();
+            }
+
+            /// Makes iterator to specific entry
+            OpenHashIterator(hashT* h, const tableT* t, std::size_t pos, entryT* entry)
+                    : h(h), t(t), pos(pos), entry(entry) {}
+
+            /// Copy constructor
+            OpenHashIterator(const OpenHashIterator& other)
+                    : h(other.h), t(other.t), pos(other.pos), entry(other.entry) {}
+
+            /// Implicit conversion of another hash type to this hash type
+
+            /// This allows implicit conversion from hash types to const hash
+            /// types.
+            template <class otherHashT>
+            OpenHashIterator(const OpenHashIterator<otherHashT>& other)
+                    : h(other.h), t(other.t), pos(other.pos), entry(other.entry) {}
+
+            OpenHashIterator& operator=(const OpenHashIterator& other) = default;
+
+            OpenHashIterator& operator++() {
+                if (!entry) return *this;
+                ++pos;
+                next_live_entry();
+                return *this;
+            }
+
+            OpenHashIterator operator++(int) {
+                OpenHashIterator old(*this);
+                operator++();
+                return old;
+            }
+
+            /// Difference between iterators \em only supported for this=start and other=end
+
+            /// This exists to support construction of range for parallel iteration
+            /// over the entire container.
+            int distance(const OpenHashIterator& other) const {
+                MADNESS_ASSERT(h == other.h  &&  other == h->end()  &&  *this == h->begin());
+                return h->size();
+            }
+
+            /// Only positive increments are supported
+
+            /// This exists to support splitting of range for parallel iteration.
+            void advance(int n) {
+                MADNESS_ASSERT(n>=0);
+                while (n-- && entry) operator++();
+            }
+
+            bool operator==(const OpenHashIterator& a) const {
+                return entry==a.entry;
+            }
+
+            bool operator!=(const OpenHashIterator& a) const {
+                return entry!=a.entry;
+            }
+
+            reference operator*() const {
+                MADNESS_ASSERT(entry);
+                return entry->datum;
+            }
+
+            pointer operator->() const {
+                MADNESS_ASSERT(entry);
+                return &entry->datum;
+            }
+        };
+
+    } // End of namespace Hash_private
+
+    /// Concurrent hash map with open addressing and lock-free lookup
+
+    /// A drop-in alternative to ConcurrentHashMap; see the comments at the
+    /// top of worldhashmap_open.h.  The constructor argument is an estimate
+    /// of the number of entries.
+    template < class keyT, class valueT, class hashfunT = Hash<keyT> >
+    class OpenHashMap {
+    public:
+        typedef OpenHashMap<keyT,valueT,hashfunT> hashT;
+        typedef std::pair<const keyT,valueT> datumT;
+        typedef Hash_private::open_entry<keyT,valueT> entryT;
+        typedef Hash_private::open_table<entryT> tableT;
+        typedef Hash_private::OpenHashIterator<hashT> iterator;
+        typedef Hash_private::OpenHashIterator<const hashT> const_iterator;
+        typedef Hash_private::HashAccessor<hashT,entryT::WRITELOCK> accessor;
+        typedef Hash_private::HashAccessor<const hashT,entryT::READLOCK> const_accessor;
+
+        friend class Hash_private::OpenHashIterator<hashT>;
+        friend class Hash_private::OpenHashIterator<const hashT>;
+
+    private:
+        typedef Hash_private::open_bucket<entryT> bucketT;
+        typedef typename std::aligned_storage<sizeof(entryT), alignof(entryT)>::type storageT;
+
+        static const int NSTRIPE = 128;   ///< No. of locks serializing insertion and removal
+        static const int NPROBE = 4;      ///< Max. no. of buckets probed for a key
+        static const std::size_t NRETIRE = 32; ///< Retired entries that trigger reclamation
+
+        /// A stripe lock with the count and storage of the entries it guards
+        struct alignas(64) stripe : public Spinlock {
+            std::atomic<std::size_t> n;   ///< No. of entries in the table
+            std::size_t nchunk;           ///< Size of the next chunk to allocate
+            std::vector<storageT*> chunks;
+            std::vector<void*> free;      ///< Unused storage from the chunks
+            std::vector<std::pair<unsigned long, entryT*> > retired;
+
+            stripe() : n(0), nchunk(16) {}
+        };
+
+        const std::size_t nbucket0;            // Initial number of buckets
+        std::atomic<tableT*> table;            // Current table
+        std::vector<tableT*> old_tables;       // Tables replaced by growth
+        stripe* stripes;
+        hashfunT hashfun;
+
+        static entryT* tombstone() {
+            return reinterpret_cast<entryT*>(std::uintptr_t(1));
+        }
+
+        static bool is_live(const entryT* e) {
+            return std::uintptr_t(e) > std::uintptr_t(1);
+        }
+
+        /// Mixes the bits of the user hash (finalizer of MurmurHash3)
+        static std::uint64_t mix(std::uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        static std::uint8_t tag_of(std::uint64_t m) { return std::uint8_t(m >> 56); }
+
+        static int stripe_of(std::uint64_t m) { return int((m >> 32) & (NSTRIPE-1)); }
+
+        static std::size_t nbucket_for(std::size_t n) {
+            // Aim for about six entries per bucket of seven slots
+            std::size_t nb = 4;
+            while (nb*6 < n) nb *= 2;
+            return nb;
+        }
+
+        const tableT* current_table() const { return table.load(std::memory_order_acquire); }
+
+        /// Finds the entry with \c key in table \c t; must be in an epoch critical section
+        entryT* match(const tableT* t, const keyT& key, madness::hashT hash, std::uint64_t m,
+                      std::size_t* pos=0) const {
+            const std::size_t mask = t->nbucket - 1;
+            const std::uint8_t tag = tag_of(m);
+            for (int p=0; p<NPROBE; ++p) {
+                const std::size_t b = (m + p) & mask;
+                const bucketT& bucket = t->buckets[b];
+                for (int i=0; i<bucketT::NSLOT; ++i) {
+                    entryT* e = bucket.slot[i].load(std::memory_order_acquire);
+                    if (!e) return 0;
+                    if (e == tombstone()) continue;
+                    if (bucket.tag[i].load(std::memory_order_relaxed) != tag) continue;
+                    if (e->hash == hash && e->datum.first == key) {
+                        if (pos) *pos = b*bucketT::NSLOT + i;
+                        return e;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        /// Puts \c e in the first free slot of its probe sequence in \c t
+
+        /// The caller must hold the stripe lock of the key (or all stripe
+        /// locks).  Returns false if the probe sequence is full.
+        static bool place(tableT* t, entryT* e, std::uint64_t m, std::size_t* pos=0) {
+            const std::size_t mask = t->nbucket - 1;
+            for (int p=0; p<NPROBE; ++p) {
+                const std::size_t b = (m + p) & mask;
+                bucketT& bucket = t->buckets[b];
+                for (int i=0; i<bucketT::NSLOT; ++i) {
+                    entryT* old = bucket.slot[i].load(std::memory_order_relaxed);
+                    // Keys in other stripes may be competing for the same slot
+                    while (!is_live(old)) {
+                        if (bucket.slot[i].compare_exchange_weak(old, e, std::memory_order_release,
+                                                                 std::memory_order_relaxed)) {
+                            bucket.tag[i].store(tag_of(m), std::memory_order_relaxed);
+                            if (pos) *pos = b*bucketT::NSLOT + i;
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        /// Replaces the table by a larger one (or a copy without tombstones)
+
+        /// Called without any stripe lock held.
+        void grow(const tableT* full) {
+            for (int i=0; i<NSTRIPE; ++i) stripes[i].lock();
+            tableT* t = table.load();
+            if (t == full) {
+                // Double the size unless a rebuild would free many tombstones
+                std::size_t ntomb = 0;
+                for (std::size_t pos=0; pos<t->nslot(); ++pos) {
+                    if (t->slot(pos).load(std::memory_order_relaxed) == tombstone()) ++ntomb;
+                }
+                std::size_t nbucket = (4*ntomb >= t->nslot()) ? t->nbucket : 2*t->nbucket;
+
+                tableT* nt;
+                while (true) {
+                    nt = new tableT(nbucket);
+                    bool ok = true;
+                    for (std::size_t pos=0; ok && pos<t->nslot(); ++pos) {
+                        entryT* e = t->slot(pos).load(std::memory_order_relaxed);
+                        if (is_live(e)) ok = place(nt, e, mix(e->hash));
+                    }
+                    if (ok) break;
+                    delete nt;
+                    nbucket *= 2;
+                }
+                old_tables.push_back(t);
+                table.store(nt);
+            }
+            for (int i=NSTRIPE-1; i>=0; --i) stripes[i].unlock();
+        }
+
+        /// Allocates storage for an entry; caller holds the stripe lock
+        static void* allocate(stripe& s) {
+            if (s.free.empty()) {
+                storageT* chunk = new storageT[s.nchunk];
+                s.chunks.push_back(chunk);
+                for (std::size_t i=s.nchunk; i>0; --i) s.free.push_back(chunk+i-1);
+                if (s.nchunk < 1024) s.nchunk *= 2;
+            }
+            void* p = s.free.back();
+            s.free.pop_back();
+            return p;
+        }
+
+        /// Replaces \c e by a tombstone in table \c t, if it is there
+        static void unlink_from(const tableT* t, const entryT* e) {
+            const std::uint64_t m = mix(e->hash);
+            const std::size_t mask = t->nbucket - 1;
+            for (int p=0; p<NPROBE; ++p) {
+                bucketT& bucket = t->buckets[(m + p) & mask];
+                for (int i=0; i<bucketT::NSLOT; ++i) {
+                    const entryT* slot = bucket.slot[i].load(std::memory_order_relaxed);
+                    if (!slot) return;
+                    if (slot == e) {
+                        bucket.slot[i].store(tombstone(), std::memory_order_release);
+                        return;
+                    }
+                }
+            }
+        }
+
+        /// Unlinks an entry found at \c pos in \c t; caller holds the stripe lock
+
+        /// The entry is also removed from the old tables so that iterators
+        /// into them never reach it after it is reclaimed.
+        void unlink(stripe& s, const tableT* t, std::size_t pos, entryT* e) {
+            t->slot(pos).store(tombstone(), std::memory_order_release);
+            for (const tableT* old : old_tables) unlink_from(old, e);
+            e->dead.store(true, std::memory_order_release);
+            s.n.fetch_sub(1, std::memory_order_relaxed);
+            s.retired.push_back(std::make_pair(Hash_private::EpochDomain::retire(), e));
+            if (s.retired.size() >= NRETIRE) reclaim(s, Hash_private::EpochDomain::oldest());
+        }
+
+        /// Destroys retired entries older than \c epoch; caller holds the stripe lock
+        static void reclaim(stripe& s, unsigned long epoch) {
+            std::size_t nkeep = 0;
+            for (std::size_t i=0; i<s.retired.size(); ++i) {
+                if (s.retired[i].first < epoch) {
+                    entryT* e = s.retired[i].second;
+                    e->~entryT();
+                    s.free.push_back(e);
+                }
+                else {
+                    s.retired[nkeep++] = s.retired[i];
+                }
+            }
+            s.retired.resize(nkeep);
+        }
+
+        /// Inserts \c datum or finds the existing entry, locking it in \c lockmode
+
+        /// Returns the entry and true if it was inserted, and its table and
+        /// slot in \c tp and \c pos .
+        std::pair<entryT*,bool> insert_and_lock(const datumT& datum, int lockmode,
+                                                const tableT** tp=0, std::size_t* pos=0) {
+            const madness::hashT hash = hashfun(datum.first);
+            const std::uint64_t m = mix(hash);
+            stripe& s = stripes[stripe_of(m)];
+            madness::MutexWaiter waiter;
+            while (true) {
+                Hash_private::EpochGuard guard;
+                s.lock();               // BEGIN CRITICAL SECTION
+                tableT* t = table.load();
+                if (tp) *tp = t;
+                entryT* e = match(t, datum.first, hash, m, pos);
+                if (e) {
+                    bool gotlock = e->try_lock(lockmode);
+                    s.unlock();         // END CRITICAL SECTION
+                    if (gotlock) return std::pair<entryT*,bool>(e,false);
+                    waiter.wait();
+                    continue;
+                }
+                e = new (allocate(s)) entryT(datum, hash);
+                e->try_lock(lockmode); // Cannot fail before the entry is visible
+                if (place(t, e, m, pos)) {
+                    s.n.fetch_add(1, std::memory_order_relaxed);
+                    s.unlock();         // END CRITICAL SECTION
+                    return std::pair<entryT*,bool>(e,true);
+                }
+                e->unlock(lockmode);
+                e->~entryT();
+                s.free.push_back(e);
+                s.unlock();             // END CRITICAL SECTION
+                grow(t);
+            }
+        }
+
+        /// Finds the entry for \c key and locks it in \c lockmode
+        entryT* find_and_lock(const keyT& key, int lockmode, const tableT** tp=0,
+                              std::size_t* pos=0) const {
+            const madness::hashT hash = hashfun(key);
+            const std::uint64_t m = mix(hash);
+            madness::MutexWaiter waiter;
+            while (true) {
+                Hash_private::EpochGuard guard;
+                const tableT* t = current_table();
+                entryT* e = match(t, key, hash, m, pos);
+                if (!e) return 0;
+                if (e->try_lock(lockmode)) {
+                    // Removal tombstones the slot before marking the entry
+                    if (!e->dead.load(std::memory_order_acquire)) {
+                        if (tp) *tp = t;
+                        return e;
+                    }
+                    e->unlock(lockmode);
+                }
+                waiter.wait();
+            }
+        }
+
+        /// Removes the entry for \c key, which the caller has locked in \c lockmode
+        bool del(const keyT& key, int lockmode) {
+            const madness::hashT hash = hashfun(key);
+            const std::uint64_t m = mix(hash);
+            stripe& s = stripes[stripe_of(m)];
+            Hash_private::EpochGuard guard;
+            s.lock();                   // BEGIN CRITICAL SECTION
+            const tableT* t = table.load();
+            std::size_t pos;
+            entryT* e = match(t, key, hash, m, &pos);
+            if (e) {
+                unlink(s, t, pos, e);
+                e->unlock(lockmode); // Still safe as the guard holds off reclamation
+            }
+            s.unlock();                 // END CRITICAL SECTION
+            return e;
+        }
+
+        /// Destroys all entries and tables; no other thread may use the map
+        void destroy() {
+            tableT* t = table.load();
+            for (std::size_t pos=0; pos<t->nslot(); ++pos) {
+                entryT* e = t->slot(pos).load();
+                if (is_live(e)) e->~entryT();
+            }
+            delete t;
+            for (tableT* old : old_tables) delete old;
+            old_tables.clear();
+            for (int i=0; i<NSTRIPE; ++i) {
+                stripe& s = stripes[i];
+                reclaim(s, std::numeric_limits<unsigned long>::max());
+                for (storageT* chunk : s.chunks) delete [] chunk;
+                s.chunks.clear();
+                s.free.clear();
+                s.nchunk = 16;
+                s.n = 0;
+            }
+        }
+
+    public:
+        OpenHashMap(int n=1021, const hashfunT& hf = hashfunT())
+                : nbucket0(nbucket_for(n))
+                , table(new tableT(nbucket0))
+                , stripes(new stripe[NSTRIPE])
+                , hashfun(hf) {}
+
+        OpenHashMap(const hashT& h)
+                : nbucket0(h.nbucket0)
+                , table(new tableT(nbucket0))
+                , stripes(new stripe[NSTRIPE])
+                , hashfun(h.hashfun) {
+            *this = h;
+        }
+
+        virtual ~OpenHashMap() {
+            destroy();
+            delete [] stripes;
+        }
+
+        hashT& operator=(const hashT& h) {
+            if (this != &h) {
+                this->clear();
+                hashfun = h.hashfun;
+                for (const_iterator p=h.begin(); p!=h.end(); ++p) {
+                    insert(*p);
+                }
+            }
+            return *this;
+        }
+
+        std::pair<iterator,bool> insert(const datumT& datum) {
+            const tableT* t;
+            std::size_t pos;
+            std::pair<entryT*,bool> r = insert_and_lock(datum, entryT::NOLOCK, &t, &pos);
+            return std::pair<iterator,bool>(iterator(this,t,pos,r.first),r.second);
+        }
+
+        /// Returns true if new pair was inserted; false if key is already in the map and the datum was not inserted
+        bool insert(accessor& result, const datumT& datum) {
+            result.release();
+            std::pair<entryT*,bool> r = insert_and_lock(datum, entryT::WRITELOCK);
+            result.set(r.first);
+            return r.second;
+        }
+
+        /// Returns true if new pair was inserted; false if key is already in the map and the datum was not inserted
+        bool insert(const_accessor& result, const datumT& datum) {
+            result.release();
+            std::pair<entryT*,bool> r = insert_and_lock(datum, entryT::READLOCK);
+            result.set(r.first);
+            return r.second;
+        }
+
+        /// Returns true if new pair was inserted; false if key is already in the map
+        inline bool insert(accessor& result, const keyT& key) {
+            return insert(result, datumT(key,valueT()));
+        }
+
+        /// Returns true if new pair was inserted; false if key is already in the map
+        inline bool insert(const_accessor& result, const keyT& key) {
+            return insert(result, datumT(key,valueT()));
+        }
+
+        std::size_t erase(const keyT& key) {
+            if (del(key,entryT::NOLOCK)) return 1;
+            else return 0;
+        }
+
+        void erase(const iterator& it) {
+            if (it == end()) MADNESS_EXCEPTION("OpenHashMap: erase(iterator): at end", true);
+            erase(it->first);
+        }
+
+        void erase(accessor& item) {
+            del(item->first,entryT::WRITELOCK);
+            item.unset();
+        }
+
+        void erase(const_accessor& item) {
+            item.convert_read_lock_to_write_lock();
+            del(item->first,entryT::WRITELOCK);
+            item.unset();
+        }
+
+        iterator find(const keyT& key) {
+            const tableT* t;
+            std::size_t pos;
+            entryT* entry = find_and_lock(key, entryT::NOLOCK, &t, &pos);
+            if (!entry) return end();
+            else return iterator(this,t,pos,entry);
+        }
+
+        const_iterator find(const keyT& key) const {
+            const tableT* t;
+            std::size_t pos;
+            const entryT* entry = find_and_lock(key, entryT::NOLOCK, &t, &pos);
+            if (!entry) return end();
+            else return const_iterator(this,t,pos,entry);
+        }
+
+        bool find(accessor& result, const keyT& key) {
+            result.release();
+            entryT* entry = find_and_lock(key, entryT::WRITELOCK);
+            bool foundit = entry;
+            if (foundit) result.set(entry);
+            return foundit;
+        }
+
+        bool find(const_accessor& result, const keyT& key) const {
+            result.release();
+            entryT* entry = find_and_lock(key, entryT::READLOCK);
+            bool foundit = entry;
+            if (foundit) result.set(entry);
+            return foundit;
+        }
+
+        /// Removes all entries; no other thread may use the map meanwhile
+        void clear() {
+            destroy();
+            table.store(new tableT(nbucket0));
+        }
+
+        size_t size() const {
+            size_t sum = 0;
+            for (int i=0; i<NSTRIPE; ++i) sum += stripes[i].n.load(std::memory_order_relaxed);
+            return sum;
+        }
+
+        valueT& operator[](const keyT& key) {
+            std::pair<iterator,bool> it = insert(datumT(key,valueT()));
+            return it.first->second;
+        }
+
+        iterator begin() {
+            return iterator(this,true);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator cbegin() const {
+            return const_iterator(this,true);
+        }
+
+        iterator end() {
+            return iterator(this,false);
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+        const_iterator cend() const {
+            return const_iterator(this,false);
+        }
+
+        const hashfunT& get_hash() const { return hashfun; }
+
+        void print_stats() const {
+            const tableT* t = current_table();
+            std::size_t nlive = 0, ntomb = 0;
+            for (std::size_t pos=0; pos<t->nslot(); ++pos) {
+                entryT* e = t->slot(pos).load();
+                if (is_live(e)) ++nlive;
+                else if (e) ++ntomb;
+            }
+            printf("OpenHashMap: %zu buckets  %zu entries  %zu tombstones  %zu old tables\n",
+                   t->nbucket, nlive, ntomb, old_tables.size());
+        }
+    };
+}
+
+namespace std {
+
+    template <typename hashT, typename distT>
+    inline void advance( madness::Hash_private::OpenHashIterator<hashT>& it, const distT& dist ) {
+        it.advance(dist);
+    }
+
+    template <typename hashT>
+    inline int distance(const madness::Hash_private::OpenHashIterator<hashT>& it, const madness::Hash_private::OpenHashIterator<hashT>& jt) {
+        return it.distance(jt);
+    }
+}
+
+#endif // MADNESS_WORLD_WORLDHASHMAP_OPEN_H__INCLUDED
@@ -100,6 +100,16 @@ namespace madness {
             << cur_num_frags << " " << std::setw(12) << max_num_frags << "\n";
         std::cout << "  cur and max bytes allocated " << std::setw(12)
             << cur_num_bytes << " " << std::setw(12) << max_num_bytes << "\n";
+
+        const PoolAllocStats p = pool_stats();
+        std::cout << "   pool blocks alloc and free " << std::setw(12)
+            << p.nalloc << " " << std::setw(12) << p.nfree << "\n";
+        std::cout << "    pool large allocs to heap " << std::setw(12)
+            << p.nlarge << "\n";
+        std::cout << "  pool batch refills & spills " << std::setw(12)
+            << p.nrefill << " " << std::setw(12) << p.nspill << "\n";
+        std::cout << "         pool bytes from heap " << std::setw(12)
+            << p.slab_bytes << "\n";
     }
 
     void WorldMemInfo::reset() {
@@ -36,6 +36,7 @@
 */
 
 #include <madness/madness_config.h>
+#include <madness/world/pool_alloc.h>
 #include <string>
 #ifdef WORLD_GATHER_MEM_STATS
 #include <new>
@@ -93,8 +94,16 @@ namespace madness {
         bool trace;
 
         /// Prints memory use statistics to std::cout
+
+        /// The statistics of the pool allocator are always printed;
+        /// the others only if compiled with WORLD_GATHER_MEM_STATS.
         void print() const;
 
+        /// Returns the statistics of the pool allocator used for active messages, tasks and futures
+        PoolAllocStats pool_stats() const {
+            return pool_alloc_stats();
+        }
+
         /// Resets all counters to zero
         void reset();
 
@@ -489,8 +489,11 @@ namespace madness {
 #endif
 
     /// wait policies supported by ConditionVariable/DQueue/ThreadPool
+
+    /// \c Adaptive spins briefly, then yields, and finally (in
+    /// \c ThreadPool::await) parks the thread until it is notified.
     enum class WaitPolicy {
-      Busy = 1, Yield, Sleep
+      Busy = 1, Yield, Sleep, Adaptive
     };
 
     /// Scalable and fair condition variable (spins on local value)
@@ -521,6 +524,9 @@ namespace madness {
 
             unlock(); // Release lock before blocking
             switch (this->wait_policy_) {
+              case WaitPolicy::Adaptive:
+                for (int i=0; i<1000 && !myturn; ++i) cpu_relax();
+                // fall through
               case WaitPolicy::Yield:
                 while (!myturn) std::this_thread::yield();
               case WaitPolicy::Sleep:
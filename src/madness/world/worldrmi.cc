@@ -46,11 +46,15 @@
 namespace madness {
 
     RMI::RmiTask* RMI::task_ptr = nullptr;
-    RMIStats RMI::stats;
+    std::vector<RMI::RmiTask*> RMI::servers;
+    thread_local RMI::RmiTask* RMI::this_server = nullptr;
     volatile bool RMI::debugging = false;
-    std::list< std::unique_ptr<RMISendReq> > RMI::send_req;
+    std::size_t RMI::bulk_min = RMI::DEFAULT_BULK_MIN;
+    std::atomic<int> RMI::bulk_next_tag{0};
+    thread_local std::list< std::unique_ptr<RMISendReq> > RMI::send_req;
 
     thread_local bool RMI::is_server_thread = false;
+    std::atomic<void (*)()> RMI::poll_hook{nullptr};
 
 #if HAVE_INTEL_TBB
     tbb::task* RMI::tbb_rmi_parent_task = nullptr;
@@ -72,10 +76,12 @@ namespace madness {
 
         MutexWaiter waiter;
         while((narrived == 0) && (iterations < 1000)) {
+          if (void (*hook)() = poll_hook.load(std::memory_order_relaxed)) hook();
           narrived = SafeMPI::Request::Testsome(maxq_, recv_req.get(), ind.get(), status.get());
           if (narrived) break;
           ++iterations;
           clear_send_req();
+          clear_bulk_req();
           myusleep(RMI::testsome_backoff_us);
         }
 
@@ -92,8 +98,8 @@ namespace madness {
                 const size_t len = status[m].Get_count(MPI_BYTE);
                 const int i = ind[m];
 
-                ++(RMI::stats.nmsg_recv);
-                RMI::stats.nbyte_recv += len;
+                ++(stats.nmsg_recv);
+                stats.nbyte_recv += len;
 
                 const header* h = (const header*)(recv_buf[i]);
                 rmi_handlerT func = archive::to_abs_fn_ptr<rmi_handlerT>(h->func);
@@ -171,7 +177,10 @@ namespace madness {
             // aggregates task submission.
             ThreadPool::instance()->flush_prebuf();
 #endif
+            // Handlers may have changed state that awaiting threads probe
+            ThreadPool::notify_waiters();
             clear_send_req();
+            clear_bulk_req();
         }
     }
 
@@ -222,10 +231,11 @@ namespace madness {
 
     static volatile bool rmi_task_is_running = false;
 
-    RMI::RmiTask::RmiTask(const SafeMPI::Intracomm& _comm)
+    RMI::RmiTask::RmiTask(const SafeMPI::Intracomm& _comm, int nserver)
             : comm(_comm.Clone())
             , nproc(comm.Get_size())
             , rank(comm.Get_rank())
+            , nbulk_req(0)
             , finished(false)
             , send_counters(new volatile counterT[nproc])
             , recv_counters(new counterT[nproc])
@@ -295,6 +305,12 @@ namespace madness {
             maxq_ = nrecv_ + 1;
         }
 
+        // Each server receives from only 1/nserver of the sources
+        if (nserver > 1) {
+            nrecv_ = std::max(nrecv_/nserver, std::size_t(32));
+            maxq_ = nrecv_ + 1;
+        }
+
         // Get environment variable controlling use of synchronous send (MAD_NSSEND)
         // negative=sends synchronous message every MAD_RECV_BUFFER sends (default)
         //        0=never send synchronous message
@@ -346,12 +362,14 @@ namespace madness {
         // the worst case is where only one node sends huge messages to every node in the communicator
         // AND it has enough threads to use up all tags
         // NB list::size() is O(1) in c++11, but O(N) in older libstdc++
+        // The huge message arrives on the communicator of the server that received this
+        RmiTask* server = RMI::this_server;
         bool OK = (ThreadPool::size() < size_t(RMI::RmiTask::unique_tag_period()) ||
-                   RMI::task_ptr->hugeq.size() <
-                   std::size_t(RMI::RmiTask::unique_tag_period() / RMI::task_ptr->comm.Get_size()));
+                   server->hugeq.size() <
+                   std::size_t(RMI::RmiTask::unique_tag_period() / server->comm.Get_size()));
         if (!OK) MADNESS_EXCEPTION("huge_msg_handler paranoid test failing", RMI::RmiTask::unique_tag_period());
-        RMI::task_ptr->hugeq.push_back(std::make_tuple(src, nbyte, tag));
-        RMI::task_ptr->post_pending_huge_msg();
+        server->hugeq.push_back(std::make_tuple(src, nbyte, tag));
+        server->post_pending_huge_msg();
     }
 
     namespace detail {
@@ -391,8 +409,16 @@ namespace madness {
             assert_aslr_off(comm);
 #endif
 
+            const char* buf = getenv("MAD_AM_BULK_SIZE");
+            if (buf) {
+                std::stringstream ss(buf);
+                long nbyte = 0;
+                ss >> nbyte;
+                bulk_min = std::max(nbyte, 0l);
+            }
+
             testsome_backoff_us = 5;
-            const char* buf = getenv("MAD_BACKOFF_US");
+            buf = getenv("MAD_BACKOFF_US");
             if (buf) {
                 std::stringstream ss(buf);
                 ss >> testsome_backoff_us;
@@ -401,7 +427,18 @@ namespace madness {
             }
 
             MADNESS_ASSERT(task_ptr == nullptr);
+
+            int nserver = 1;
+            buf = getenv("MAD_RMI_SERVERS");
+            if (buf) {
+                std::stringstream ss(buf);
+                ss >> nserver;
+                nserver = std::max(1, std::min(nserver, comm.Get_size()));
+            }
 #if HAVE_INTEL_TBB
+            if (nserver > 1 && comm.Get_rank() == 0)
+                print_error("!!! WARNING: MAD_RMI_SERVERS is ignored with TBB, using one RMI server\n");
+            nserver = 1;
 
             // Force the RMI task to be picked up by someone other than main thread
             // by keeping main thread occupied AND enqueing enough dummy tasks to make
@@ -411,6 +448,7 @@ namespace madness {
                 new (tbb::task::allocate_root()) tbb::empty_task;
             tbb_rmi_parent_task->set_ref_count(2);
             task_ptr = new (tbb_rmi_parent_task->allocate_child()) RmiTask(comm);
+            servers.push_back(task_ptr);
 #ifdef MADNESS_CAN_USE_TBB_PRIORITY
             tbb::task::enqueue(*task_ptr, tbb::priority_high);
 #else
@@ -450,8 +488,10 @@ namespace madness {
             tbb::task::destroy(*empty_root);
             task_ptr->comm.Barrier();
 #else
-            task_ptr = new RmiTask(comm);
-            task_ptr->start();
+            // Each server clones comm so its messages cannot match another's receives
+            for (int i=0; i<nserver; ++i) servers.push_back(new RmiTask(comm, nserver));
+            task_ptr = servers[comm.Get_rank() % nserver];
+            for (RmiTask* server : servers) server->start();
 #endif // HAVE_INTEL_TBB
         }
 
@@ -514,8 +554,8 @@ namespace madness {
         h->func = archive::to_rel_fn_ptr(func);
         h->attr = attr;
 
-        ++(RMI::stats.nmsg_sent);
-        RMI::stats.nbyte_sent += nbyte;
+        ++(stats.nmsg_sent);
+        stats.nbyte_sent += nbyte;
 
 
         numsent++;
@@ -533,6 +573,35 @@ namespace madness {
         return result;
     }
 
+    RMI::Request
+    RMI::RmiTask::bulk_isend(const void* buf, size_t nbyte, ProcessID dest, int tag, std::shared_ptr<const void> keeper) {
+        MADNESS_ASSERT(nbyte <= std::size_t(std::numeric_limits<int>::max()));
+
+        if (RMI::debugging)
+          print_error(rank, ":RMI: sending bulk buf=", buf, " nbyte=", nbyte,
+                      " dest=", dest, " tag=", tag, "\n");
+
+        lock();
+        ++(stats.nbulk_sent);
+        stats.nbyte_bulk_sent += nbyte;
+        Request result = comm.Isend(buf, nbyte, MPI_BYTE, dest, tag);
+        bulk_req.emplace_back(result, std::move(keeper));
+        ++nbulk_req;
+        unlock();
+
+        return result;
+    }
+
+    void RMI::bulk_recv(void* buf, size_t nbyte, ProcessID src, int tag) {
+        MADNESS_ASSERT(task_ptr);
+        MADNESS_ASSERT(nbyte <= std::size_t(std::numeric_limits<int>::max()));
+        // The block was sent on the communicator of the server that handles messages from src
+        RmiTask* server = servers[src % servers.size()];
+        Request req = server->comm.Irecv(buf, nbyte, MPI_BYTE, src, tag);
+        MutexWaiter waiter;
+        while (!req.Test()) waiter.wait();
+    }
+
     int RMI::RmiTask::unique_tag() const {
         constexpr int first_tag = 4096;
         static int tag = first_tag;
@@ -41,14 +41,24 @@
 #include <list>
 #include <memory>
 #include <tuple>
+#include <vector>
+#include <algorithm>
+#include <atomic>
 #include <pthread.h>
 #include <madness/world/print.h>
 
 /*
-  There is just one server thread and it is the only one
+  By default there is just one server thread and it is the only one
   messing with the recv buffers, so there is no need for
   mutex on recv related data.
 
+  Optionally (MAD_RMI_SERVERS=n) there are n server threads, each
+  with its own clone of the communicator, recv buffers and counters.
+  Sources are partitioned among the servers --- process p sends all
+  of its messages with server p%n --- so messages from one source are
+  all handled by one server and ordering is unchanged.  Handlers from
+  different sources may then run concurrently.
+
   Multiple threads (including the server) may send hence
   we need to be careful about send-related data.
 
@@ -90,6 +100,12 @@
   void RMI::set_debug(bool)
   - to set the debug flag
 
+  Large blocks of data (e.g., tensors in active messages) may also be
+  sent beside a message with RMI::bulk_isend, and received with
+  RMI::bulk_recv by whoever reads the message.  They use the
+  communicator of the server that handles messages from the source,
+  with tags that the sender takes from RMI::bulk_tag().
+
 */
 
 /**
@@ -132,9 +148,23 @@ namespace madness {
         uint64_t nmsg_recv;
         uint64_t nbyte_recv;
         uint64_t max_serv_send_q;
+        uint64_t nbulk_sent;
+        uint64_t nbyte_bulk_sent;
 
         RMIStats()
-            : nmsg_sent(0), nbyte_sent(0), nmsg_recv(0), nbyte_recv(0), max_serv_send_q(0) {}
+            : nmsg_sent(0), nbyte_sent(0), nmsg_recv(0), nbyte_recv(0), max_serv_send_q(0)
+            , nbulk_sent(0), nbyte_bulk_sent(0) {}
+
+        RMIStats& operator+=(const RMIStats& other) {
+            nmsg_sent += other.nmsg_sent;
+            nbyte_sent += other.nbyte_sent;
+            nmsg_recv += other.nmsg_recv;
+            nbyte_recv += other.nbyte_recv;
+            max_serv_send_q = std::max(max_serv_send_q, other.max_serv_send_q);
+            nbulk_sent += other.nbulk_sent;
+            nbyte_bulk_sent += other.nbyte_bulk_sent;
+            return *this;
+        }
     };
 
     /// This for RMI server thread to manage lifetime of WorldAM messages that it is sending
@@ -168,21 +198,11 @@ namespace madness {
         static void set_this_thread_is_server(bool flag = true) {is_server_thread = flag;}
         static bool get_this_thread_is_server() {return is_server_thread;}
 
-        static std::list< std::unique_ptr<RMISendReq> > send_req; // List of outstanding world active messages sent by the server
+        static thread_local std::list< std::unique_ptr<RMISendReq> > send_req; // List of outstanding world active messages sent by this server thread
 
     private:
 
-        static void clear_send_req() {
-            //std::cout << "clearing server messages " << pthread_self() << std::endl;
-            stats.max_serv_send_q = std::max(stats.max_serv_send_q,uint64_t(send_req.size()));
-            auto it=send_req.begin();
-            while (it != send_req.end()) {
-                if ((*it)->TestAndFree()) 
-                    it = send_req.erase(it);
-                else 
-                    ++it;
-            }
-        }
+        static std::atomic<void (*)()> poll_hook; // Called by the server each time it polls for messages
 
         class RmiTask
 #if HAVE_INTEL_TBB
@@ -202,6 +222,10 @@ namespace madness {
             /// q of huge messages, each msg = {source,nbytes,tag}
             std::list< std::tuple<int,size_t,int> > hugeq;
 
+            /// Pending bulk sends, each holding what keeps its data alive (protected by the mutex)
+            std::list< std::pair<SafeMPI::Request, std::shared_ptr<const void> > > bulk_req;
+            std::atomic<std::size_t> nbulk_req; ///< Size of bulk_req
+
             SafeMPI::Intracomm comm;
             const int nproc;            // No. of processes in comm world
             const ProcessID rank;       // Rank of this process
@@ -220,12 +244,43 @@ namespace madness {
             std::unique_ptr<int[]> ind;
             std::unique_ptr<qmsg[]> q;
             int n_in_q;
+            RMIStats stats;             // Messages sent with and received by this server
 
             static inline bool is_ordered(attrT attr) { return attr & ATTR_ORDERED; }
 
             void process_some();
 
-            RmiTask(const SafeMPI::Intracomm& comm = SafeMPI::COMM_WORLD);
+            void clear_send_req() {
+                //std::cout << "clearing server messages " << pthread_self() << std::endl;
+                stats.max_serv_send_q = std::max(stats.max_serv_send_q,uint64_t(send_req.size()));
+                auto it=send_req.begin();
+                while (it != send_req.end()) {
+                    if ((*it)->TestAndFree()) 
+                        it = send_req.erase(it);
+                    else 
+                        ++it;
+                }
+            }
+
+            /// Releases the data of completed bulk sends
+            void clear_bulk_req() {
+                if (nbulk_req.load(std::memory_order_relaxed) == 0) return;
+                lock();
+                auto it=bulk_req.begin();
+                while (it != bulk_req.end()) {
+                    if (it->first.Test()) {
+                        it = bulk_req.erase(it);
+                        --nbulk_req;
+                    }
+                    else
+                        ++it;
+                }
+                unlock();
+            }
+
+            Request bulk_isend(const void* buf, size_t nbyte, ProcessID dest, int tag, std::shared_ptr<const void> keeper);
+
+            RmiTask(const SafeMPI::Intracomm& comm = SafeMPI::COMM_WORLD, int nserver = 1);
             virtual ~RmiTask();
 
             static void set_rmi_task_is_running(bool flag = true);
@@ -234,6 +289,7 @@ namespace madness {
             tbb::task* execute() {
                 set_rmi_task_is_running(true);
                 RMI::set_this_thread_is_server(true);
+                this_server = this;
 
                 while (! finished) process_some();
                 finished = false;  // to ensure that RmiTask::exit() that
@@ -246,6 +302,7 @@ namespace madness {
 #else
             void run() {
                 RMI::set_this_thread_is_server(true);
+                this_server = this;
                 try {
                     while (! finished) process_some();
                     finished = false;
@@ -291,9 +348,16 @@ namespace madness {
         static tbb::task* tbb_rmi_parent_task;
 #endif // HAVE_INTEL_TBB
 
-        static RmiTask* task_ptr;    // Pointer to the singleton instance
-        static RMIStats stats;
+        static RmiTask* task_ptr;    // Pointer to the server that this process sends with
+        static std::vector<RmiTask*> servers; // All servers (task_ptr is servers[rank%nserver])
+        static thread_local RmiTask* this_server; // Server run by this thread, if any
         static volatile bool debugging;    // True if debugging
+        static std::size_t bulk_min;       // Smallest block sent beside a message (0 if none are)
+        static std::atomic<int> bulk_next_tag;
+
+        static const int BULK_FIRST_TAG = 8192;   //!< Bulk tags follow the huge message tags (4096 to 8191) ...
+        static const int BULK_TAG_PERIOD = 24576; //!< ... up to 32767, the largest tag MPI guarantees
+        static const std::size_t DEFAULT_BULK_MIN = 256*1024; //!< the default of bulk_threshold(); can be configured by the user via envvar MAD_AM_BULK_SIZE
 
         static const size_t DEFAULT_MAX_MSG_LEN = 3*512*1024;  //!< the default size of recv buffers, in bytes; the actual size can be configured by the user via envvar MAD_BUFFER_SIZE
         static const int DEFAULT_NRECV = 128;  //!< the default # of recv buffers; the actual number can be configured by the user via envvar MAD_RECV_BUFFERS
@@ -356,22 +420,95 @@ namespace madness {
 
         static void end() {
             if(task_ptr) {
-                task_ptr->exit();
+                // Every block was received before the final fence, so these complete
+                MutexWaiter waiter;
+                while (task_ptr->nbulk_req) {
+                    task_ptr->clear_bulk_req();
+                    waiter.wait();
+                }
+                for (RmiTask* server : servers) server->exit();
 #if HAVE_INTEL_TBB
                 tbb_rmi_parent_task->wait_for_all();
                 tbb::task::destroy(*tbb_rmi_parent_task);
 #else
-                delete task_ptr;
+                for (RmiTask* server : servers) delete server;
 #endif // HAVE_INTEL_TBB
+                servers.clear();
                 task_ptr = nullptr;
             }
         }
 
+        /// Returns the size in bytes of the smallest block sent beside an active message
+
+        /// Zero if blocks are always copied into the message.
+        /// @note The default is RMI::DEFAULT_BULK_MIN, can be overridden at runtime by the user via environment variable MAD_AM_BULK_SIZE.
+        static std::size_t bulk_threshold() { return bulk_min; }
+
+        /// Sets the size in bytes of the smallest block sent beside an active message, or zero for none
+
+        /// Affects only messages made afterwards, and only by this process.
+        static void set_bulk_threshold(std::size_t nbyte) { bulk_min = nbyte; }
+
+        /// Returns the tag to send the next block with
+
+        /// The tags are reused after RMI::BULK_TAG_PERIOD blocks, which
+        /// bounds how many blocks this process may have in flight.
+        static int bulk_tag() {
+            return BULK_FIRST_TAG + int(unsigned(bulk_next_tag++) % BULK_TAG_PERIOD);
+        }
+
+        /// Sends a block that travels beside an active message
+
+        /// The send is completed by the server thread, which then releases \c keeper.
+        /// @param[in] buf Pointer to the data (do not modify until the send is completed)
+        /// @param[in] nbyte Size of the data in bytes
+        /// @param[in] dest Process to receive the data, in COMM_WORLD
+        /// @param[in] tag From bulk_tag(), which the receiver must be told
+        /// @param[in] keeper Keeps the data alive until the send is completed
+        static void bulk_isend(const void* buf, size_t nbyte, ProcessID dest, int tag, std::shared_ptr<const void> keeper) {
+            MADNESS_ASSERT(task_ptr);
+            task_ptr->bulk_isend(buf, nbyte, dest, tag, std::move(keeper));
+        }
+
+        /// Receives a block sent with bulk_isend, waiting until it arrives
+        /// @param[out] buf Where to put the data
+        /// @param[in] nbyte Size of the data in bytes
+        /// @param[in] src Process that sent the data, in COMM_WORLD
+        /// @param[in] tag The tag it was sent with
+        static void bulk_recv(void* buf, size_t nbyte, ProcessID src, int tag);
+
         static void set_debug(bool status) { debugging = status; }
 
         static bool get_debug() { return debugging; }
 
-        static const RMIStats& get_stats() { return stats; }
+        /// Returns the statistics summed over all servers
+        static RMIStats get_stats() {
+            RMIStats result;
+            for (const RmiTask* server : servers) result += server->stats;
+            return result;
+        }
+
+        /// Returns the statistics of one server
+
+        /// Sends are counted by the server of the sending process, receives by
+        /// the server of the receiving process
+        /// @param[in] i The server, in [0,nserver())
+        static RMIStats get_stats(int i) {
+            MADNESS_ASSERT(i>=0 && i<nserver());
+            return servers[i]->stats;
+        }
+
+        /// Returns the number of server threads (zero if RMI is not running)
+
+        /// @note The default is one, can be overridden at runtime by the user via environment variable MAD_RMI_SERVERS.
+        static int nserver() { return servers.size(); }
+
+        /// Sets a function that the server thread calls each time it polls for incoming messages
+
+        /// The hook runs on the server thread so it must not block; WorldAmInterface
+        /// uses it to send aggregated messages that have been held too long.
+        /// @param[in] hook The function to call, or nullptr to remove the hook
+        static void set_poll_hook(void (*hook)()) { poll_hook = hook; }
     }; // class RMI
 
 } // namespace madness
@@ -0,0 +1,240 @@
+/*
+  This file is part of MADNESS.
+
+  Copyright (C) 2007,2010 Oak Ridge National Laboratory
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+
+  For more information please contact:
+
+  Robert J. Harrison
+  Oak Ridge National Laboratory
+  One Bethel Valley Road
+  P.O. Box 2008, MS-6367
+
+  email: harrisonrj@ornl.gov
+  tel:   865-241-3937
+  fax:   865-572-0680
+*/
+
+#ifndef MADNESS_WORLD_WSDEQUE_H__INCLUDED
+#define MADNESS_WORLD_WSDEQUE_H__INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/// \file wsdeque.h
+/// \brief Implements WSDeque, the Chase-Lev work-stealing deque
+
+namespace madness {
+
+    struct WSDequeStats {
+        uint64_t npush;         ///< #calls to push by the owner
+        uint64_t npop;          ///< #successful pops by the owner
+        uint64_t nsteal;        ///< #successful steals by other threads
+        uint64_t nsteal_fail;   ///< #steal attempts that found the deque empty or lost a race
+        uint64_t ngrow;         ///< #calls to grow
+
+        WSDequeStats()
+                : npush(0), npop(0), nsteal(0), nsteal_fail(0), ngrow(0) {}
+
+        WSDequeStats& operator+=(const WSDequeStats& other) {
+            npush += other.npush;
+            npop += other.npop;
+            nsteal += other.nsteal;
+            nsteal_fail += other.nsteal_fail;
+            ngrow += other.ngrow;
+            return *this;
+        }
+    };
+
+
+    /// A single-owner, multi-thief work-stealing deque.
+
+    /// This is the Chase-Lev dynamic circular deque using the C11
+    /// memory model formulation of Le, Pop, Cohen and Zappa Nardelli
+    /// (PPoPP 2013).  The owning thread pushes and pops at the bottom
+    /// (LIFO, so recently spawned tasks with a warm cache run first)
+    /// while any other thread may steal from the top (FIFO, so thieves
+    /// take the oldest and typically largest pieces of work).  Neither
+    /// the owner's push/pop nor a steal takes a lock; the only
+    /// contended operation is a CAS on \c top when the owner and a
+    /// thief race for the last element.
+    ///
+    /// The buffer grows as needed but never shrinks.  Retired buffers
+    /// are kept until the deque is destroyed since a concurrent thief
+    /// may still be reading from them; doubling means the total
+    /// retained storage is bounded by twice the largest buffer.
+    ///
+    /// \c T must be trivially copyable (in practice it is a pointer).
+    template <typename T>
+    class WSDeque {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "WSDeque requires a trivially copyable element type");
+
+        class Array {
+            const std::int64_t mask_;
+            std::atomic<T>* const data_;
+
+        public:
+            explicit Array(std::int64_t capacity)
+                    : mask_(capacity-1), data_(new std::atomic<T>[capacity]) {}
+
+            ~Array() { delete [] data_; }
+
+            std::int64_t capacity() const { return mask_+1; }
+
+            T get(std::int64_t i) const {
+                return data_[i & mask_].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t i, T value) {
+                data_[i & mask_].store(value, std::memory_order_relaxed);
+            }
+
+            /// Returns a new array of twice the size holding elements [t,b)
+            Array* grow(std::int64_t t, std::int64_t b) const {
+                Array* a = new Array(2*capacity());
+                for (std::int64_t i=t; i<b; ++i) a->put(i, get(i));
+                return a;
+            }
+        };
+
+        alignas(64) std::atomic<std::int64_t> top_;    ///< Steal end, advanced by thieves
+        alignas(64) std::atomic<std::int64_t> bottom_; ///< Owner end
+        std::atomic<Array*> array_;                    ///< Current buffer
+        std::vector<Array*> retired_;                  ///< Old buffers (owner only)
+        WSDequeStats stats_;                           ///< Owner-side statistics
+        alignas(64) std::atomic<uint64_t> nsteal_;      ///< Thief-side statistics
+        std::atomic<uint64_t> nsteal_fail_;
+
+    public:
+
+        /// Construct with initial capacity (rounded up to a power of two)
+        explicit WSDeque(std::size_t hint=1024)
+                : top_(0), bottom_(0), array_(nullptr), nsteal_(0), nsteal_fail_(0) {
+            std::int64_t capacity = 2;
+            while (capacity < std::int64_t(hint)) capacity <<= 1;
+            array_.store(new Array(capacity), std::memory_order_relaxed);
+        }
+
+        WSDeque(const WSDeque&) = delete;
+        WSDeque& operator=(const WSDeque&) = delete;
+
+        ~WSDeque() {
+            delete array_.load(std::memory_order_relaxed);
+            for (Array* a : retired_) delete a;
+        }
+
+        /// Push onto the bottom ... only the owner may call this
+        void push(T value) {
+            std::int64_t b = bottom_.load(std::memory_order_relaxed);
+            std::int64_t t = top_.load(std::memory_order_acquire);
+            Array* a = array_.load(std::memory_order_relaxed);
+            if (b - t > a->capacity() - 1) {
+                Array* bigger = a->grow(t, b);
+                retired_.push_back(a);
+                array_.store(bigger, std::memory_order_release);
+                a = bigger;
+                ++(stats_.ngrow);
+            }
+            a->put(b, value);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            ++(stats_.npush);
+        }
+
+        /// Pop from the bottom (LIFO) ... only the owner may call this
+
+        /// \param[out] value The popped element if successful
+        /// \return True if an element was popped
+        bool pop(T& value) {
+            std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* a = array_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top_.load(std::memory_order_relaxed);
+
+            bool got = true;
+            if (t <= b) {
+                value = a->get(b);
+                if (t == b) {
+                    // Last element ... race any thieves for it
+                    if (!top_.compare_exchange_strong(t, t + 1,
+                                                      std::memory_order_seq_cst,
+                                                      std::memory_order_relaxed))
+                        got = false;
+                    bottom_.store(b + 1, std::memory_order_relaxed);
+                }
+            }
+            else {
+                got = false;
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+            if (got) ++(stats_.npop);
+            return got;
+        }
+
+        /// Steal from the top (FIFO) ... any thread may call this
+
+        /// \param[out] value The stolen element if successful
+        /// \return True if an element was stolen, false if the deque
+        /// was empty or the steal lost a race (callers typically just
+        /// move on to another victim)
+        bool steal(T& value) {
+            std::int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t < b) {
+                Array* a = array_.load(std::memory_order_consume);
+                T x = a->get(t);
+                if (top_.compare_exchange_strong(t, t + 1,
+                                                 std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+                    value = x;
+                    nsteal_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            nsteal_fail_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        /// Approximate number of elements (exact if called by the owner with no thieves)
+        std::size_t size() const {
+            std::int64_t b = bottom_.load(std::memory_order_relaxed);
+            std::int64_t t = top_.load(std::memory_order_relaxed);
+            return (b > t) ? std::size_t(b - t) : 0;
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        /// Returns a snapshot of the statistics (approximate while running)
+        WSDequeStats get_stats() const {
+            WSDequeStats s = stats_;
+            s.nsteal = nsteal_.load(std::memory_order_relaxed);
+            s.nsteal_fail = nsteal_fail_.load(std::memory_order_relaxed);
+            return s;
+        }
+    };
+
+}  // namespace madness
+
+#endif // MADNESS_WORLD_WSDEQUE_H__INCLUDED